@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmake.h>
+#include <cstdint>
+#include <Arena.h>
+
+////////////////////////////////////////////////////////////////////////////////
+Arena::~Arena ()
+{
+  for (auto& block : _blocks)
+    delete[] block;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Blocks double in size, up to 1MiB, so that small requests stay small and
+// large ones need few blocks.  Anything bigger than a block gets its own.
+void* Arena::allocate (std::size_t size, std::size_t align)
+{
+  auto padding = (align - reinterpret_cast <std::uintptr_t> (_next) % align) % align;
+  if (! _next || padding + size > _left)
+  {
+    auto block_size = size + align > _block_size ? size + align : _block_size;
+    _blocks.push_back (new char[block_size]);
+    _next = _blocks.back ();
+    _left = block_size;
+    _size += block_size;
+
+    if (_block_size < 1048576)
+      _block_size *= 2;
+
+    padding = (align - reinterpret_cast <std::uintptr_t> (_next) % align) % align;
+  }
+
+  void* memory = _next + padding;
+  _next += padding + size;
+  _left -= padding + size;
+  ++_allocations;
+  return memory;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t Arena::allocations () const
+{
+  return _allocations;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t Arena::size () const
+{
+  return _size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
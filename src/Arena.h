@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef INCLUDED_ARENA
+#define INCLUDED_ARENA
+
+#include <cstddef>
+#include <vector>
+
+// Memory for the many small, short-lived objects of one request.  Allocations
+// are carved from large blocks and are never freed individually; all blocks
+// are released together when the arena is destroyed.
+class Arena
+{
+public:
+  Arena () = default;
+  Arena (const Arena&) = delete;
+  Arena& operator= (const Arena&) = delete;
+  ~Arena ();
+
+  void* allocate (std::size_t, std::size_t);
+  std::size_t allocations () const;
+  std::size_t size () const;
+
+private:
+  std::vector <char*>  _blocks      {};
+  char*                _next        {nullptr};
+  std::size_t          _left        {0};
+  std::size_t          _block_size  {16384};
+  std::size_t          _allocations {0};
+  std::size_t          _size        {0};
+};
+
+// Allows standard containers to use an Arena.
+template <typename T>
+class ArenaAllocator
+{
+public:
+  typedef T value_type;
+
+  ArenaAllocator (Arena& arena) : _arena (&arena) {}
+  template <typename U>
+  ArenaAllocator (const ArenaAllocator <U>& other) : _arena (other._arena) {}
+
+  T* allocate (std::size_t n)
+  {
+    return static_cast <T*> (_arena->allocate (n * sizeof (T), alignof (T)));
+  }
+
+  void deallocate (T*, std::size_t) {}
+
+  template <typename U>
+  bool operator== (const ArenaAllocator <U>& other) const { return _arena == other._arena; }
+  template <typename U>
+  bool operator!= (const ArenaAllocator <U>& other) const { return _arena != other._arena; }
+
+  Arena* _arena;
+};
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmake.h>
+#include <Attributes.h>
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////
+static bool nameLess (const Attributes::value_type& attribute, const std::string& name)
+{
+  return attribute.first < name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Attributes::iterator Attributes::begin ()
+{
+  return _data.begin ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Attributes::iterator Attributes::end ()
+{
+  return _data.end ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Attributes::const_iterator Attributes::begin () const
+{
+  return _data.begin ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Attributes::const_iterator Attributes::end () const
+{
+  return _data.end ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Attributes::iterator Attributes::find (const std::string& name)
+{
+  auto i = lower_bound (name);
+  if (i != _data.end () && i->first == name)
+    return i;
+
+  return _data.end ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Attributes::const_iterator Attributes::find (const std::string& name) const
+{
+  auto i = lower_bound (name);
+  if (i != _data.end () && i->first == name)
+    return i;
+
+  return _data.end ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string& Attributes::operator[] (const std::string& name)
+{
+  auto i = lower_bound (name);
+  if (i == _data.end () || i->first != name)
+    i = _data.insert (i, std::make_pair (name, std::string ()));
+
+  return i->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// As with std::map, an existing attribute is left unchanged.
+std::pair <Attributes::iterator, bool> Attributes::insert (const value_type& attribute)
+{
+  auto i = lower_bound (attribute.first);
+  if (i != _data.end () && i->first == attribute.first)
+    return std::make_pair (i, false);
+
+  return std::make_pair (_data.insert (i, attribute), true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t Attributes::erase (const std::string& name)
+{
+  auto i = find (name);
+  if (i == _data.end ())
+    return 0;
+
+  _data.erase (i);
+  return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Attributes::iterator Attributes::erase (iterator i)
+{
+  return _data.erase (i);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Attributes::clear ()
+{
+  _data.clear ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t Attributes::size () const
+{
+  return _data.size ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Attributes::empty () const
+{
+  return _data.empty ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Attributes::iterator Attributes::lower_bound (const std::string& name)
+{
+  return std::lower_bound (_data.begin (), _data.end (), name, nameLess);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Attributes::const_iterator Attributes::lower_bound (const std::string& name) const
+{
+  return std::lower_bound (_data.begin (), _data.end (), name, nameLess);
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef INCLUDED_ATTRIBUTES
+#define INCLUDED_ATTRIBUTES
+
+#include <string>
+#include <vector>
+#include <utility>
+
+// Task attributes, as a vector of name/value pairs kept sorted by name.  It
+// offers the parts of the std::map interface that Task uses, and iterates in
+// the same order, but holds all attributes in one allocation instead of a node
+// apiece, and attribute names are short enough to be stored inline.
+class Attributes
+{
+public:
+  typedef std::pair <std::string, std::string>     value_type;
+  typedef std::vector <value_type>::iterator       iterator;
+  typedef std::vector <value_type>::const_iterator const_iterator;
+
+  iterator begin ();
+  iterator end ();
+  const_iterator begin () const;
+  const_iterator end () const;
+  iterator find (const std::string&);
+  const_iterator find (const std::string&) const;
+  std::string& operator[] (const std::string&);
+  std::pair <iterator, bool> insert (const value_type&);
+  size_t erase (const std::string&);
+  iterator erase (iterator);
+  void clear ();
+  size_t size () const;
+  bool empty () const;
+
+private:
+  iterator lower_bound (const std::string&);
+  const_iterator lower_bound (const std::string&) const;
+
+private:
+  std::vector <value_type> _data {};
+};
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
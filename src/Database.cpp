@@ -26,6 +26,12 @@
 
 #include <cmake.h>
 #include <iostream>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h>
+#endif
 #include <sstream>
 #include <algorithm>
 #include <utf8.h>
@@ -36,6 +42,10 @@
 #include <format.h>
 #include <Database.h>
 
+// The most directories watched at once, well within the default limit on
+// inotify watches per user.
+static const size_t MAX_WATCHES = 4096;
+
 ////////////////////////////////////////////////////////////////////////////////
 Database::Database (Config* config)
 : _config (config)
@@ -45,14 +55,40 @@ Database::Database (Config* config)
 ////////////////////////////////////////////////////////////////////////////////
 Database::~Database ()
 {
+  if (_inotify != -1)
+    close (_inotify);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void Database::setLog (Log* l)
+void Database::setLog (SharedLog* l)
 {
   _log = l;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// The outcome of examining an org and user on disk is cached, and the
+// directories examined are watched, so that any change to them, such as a
+// suspension, clears the cache before the next request is authenticated.
+// Without inotify, there is no cache.
+void Database::enableCache ()
+{
+#ifdef HAVE_INOTIFY
+  if (_inotify == -1)
+  {
+    _inotify = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotify == -1 && _log)
+      _log->write (format ("WARNING Authentication cache disabled: {1}", strerror (errno)));
+  }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Database::invalidate ()
+{
+  std::lock_guard <std::mutex> lock (_mutex);
+  forget ();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Authentication is when the org/user/key data exists/matches that on the
 // server, in the absence of org/user account suspension.
@@ -67,8 +103,67 @@ bool Database::authenticate (
   auto user = request.get ("user");
   auto key  = request.get ("key");
 
+  auto org_path  = _config->get ("root") + "/orgs/" + org;
+  auto user_path = org_path + "/users/" + key;
+
+  Account account;
+  if (_inotify == -1)
+    return lookup (org_path, user_path, account, response) &&
+           verify (account, org, user, response);
+
+  // The lock is only held to consult the cache, so that examining the disk
+  // for one account does not hold up the authentication of others.
+  auto id = org + '/' + key;
+  unsigned int generation;
+  bool cached;
+  {
+    std::lock_guard <std::mutex> lock (_mutex);
+    readEvents ();
+
+    auto found = _accounts.find (id);
+    cached = found != _accounts.end ();
+    if (cached)
+      account = found->second;
+
+    generation = _generation;
+  }
+
+  if (cached)
+    return verify (account, org, user, response);
+
+  // Watching begins before the directories are examined, so that a change
+  // made while they are examined is not missed.  Only directories that exist
+  // can be watched, which keeps unknown keys out of the cache.
+  int org_watch  = watch (org_path);
+  int user_watch = org_watch == -1 ? -1 : watch (user_path);
+  bool found = lookup (org_path, user_path, account, response);
+
+  // If the cache was cleared in the meantime, the change that cleared it may
+  // not be reflected in what was found, so that is not cached.
+  {
+    std::lock_guard <std::mutex> lock (_mutex);
+    remember (org_watch);
+    remember (user_watch);
+    readEvents ();
+
+    if (found && user_watch != -1 && generation == _generation)
+      _accounts[id] = account;
+  }
+
+  return found && verify (account, org, user, response);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Examines <root>/orgs/<org> and <root>/orgs/<org>/users/<key>, stopping at
+// the first suspension found.
+bool Database::lookup (
+  const std::string& org_path,
+  const std::string& user_path,
+  Account& account,
+  Msg& response)
+{
   // Verify existence of <root>/orgs/<org>
-  Directory org_dir (_config->get ("root") + "/orgs/" + org);
+  Directory org_dir (org_path);
   if (! verifyExistence  (org_dir, response) ||
       ! verifyExecutable (org_dir, response) ||
       ! verifyReadable   (org_dir, response) ||
@@ -76,19 +171,12 @@ bool Database::authenticate (
     return false;
 
   // Verify non-existence of <root>/orgs/<org>/suspended
-  File org_suspended (_config->get ("root") + "/orgs/" + org + "/suspended");
-  if (org_suspended.exists ())
-  {
-    if (_log)
-      _log->write (format ("INFO Auth failure: org '{1}' suspended", org));
-
-    response.set ("code", 431);
-    response.set ("status", taskd_error (431));
-    return false;
-  }
+  account.org_suspended = File (org_path + "/suspended").exists ();
+  if (account.org_suspended)
+    return true;
 
   // Verify existence of <root>/orgs/<org>/users/<key>
-  Directory user_dir (_config->get ("root") + "/orgs/" + org + "/users/" + key);
+  Directory user_dir (user_path);
   if (! verifyExistence  (user_dir, response) ||
       ! verifyExecutable (user_dir, response) ||
       ! verifyReadable   (user_dir, response) ||
@@ -96,8 +184,34 @@ bool Database::authenticate (
     return false;
 
   // Verify non-existence of <root>/orgs/<org>/users/<key>/suspended
-  File user_suspended (_config->get ("root") + "/orgs/" + org + "/users/" + key + "/suspended");
-  if (user_suspended.exists ())
+  account.user_suspended = File (user_path + "/suspended").exists ();
+  if (account.user_suspended)
+    return true;
+
+  // The user name, from <root>/orgs/<org>/users/<key>/config
+  Config user_rc (user_path + "/config");
+  account.user = user_rc.get ("user");
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Database::verify (
+  const Account& account,
+  const std::string& org,
+  const std::string& user,
+  Msg& response)
+{
+  if (account.org_suspended)
+  {
+    if (_log)
+      _log->write (format ("INFO Auth failure: org '{1}' suspended", org));
+
+    response.set ("code", 431);
+    response.set ("status", taskd_error (431));
+    return false;
+  }
+
+  if (account.user_suspended)
   {
     if (_log)
       _log->write (format ("INFO Auth failure: org '{1}' user '{2}' suspended", org, user));
@@ -108,8 +222,7 @@ bool Database::authenticate (
   }
 
   // Match <user> against <root>/orgs/<org>/users/<key>/rc:<user>
-  Config user_rc (_config->get ("root") + "/orgs/" + org + "/users/" + key + "/config");
-  if (!user.empty () && user_rc.get ("user") != user)
+  if (!user.empty () && account.user != user)
   {
     if (_log)
       _log->write (format ("INFO Auth failure: org '{1}' user '{2}' bad key", org, user));
@@ -123,6 +236,83 @@ bool Database::authenticate (
   return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Returns the watch descriptor, or -1 if the directory cannot be watched.
+int Database::watch (const std::string& path)
+{
+#ifdef HAVE_INOTIFY
+  return inotify_add_watch (_inotify,
+                            path.c_str (),
+                            IN_ATTRIB      | IN_CREATE     | IN_DELETE   |
+                            IN_MODIFY      | IN_MOVED_FROM | IN_MOVED_TO |
+                            IN_DELETE_SELF | IN_MOVE_SELF);
+#else
+  return -1;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Keeps track of a watch, so that it can be removed.  Watches are only needed
+// for cached accounts, so once there are more than MAX_WATCHES, everything is
+// forgotten, and the accounts in use are watched again as they are examined.
+void Database::remember (int wd)
+{
+  if (wd == -1)
+    return;
+
+  _watches.insert (wd);
+  if (_watches.size () > MAX_WATCHES)
+    forget ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Clears the cache, and removes the watches, which only served to keep it
+// current.  Any lookup under way when this happens is not cached.
+void Database::forget ()
+{
+  _accounts.clear ();
+  ++_generation;
+
+#ifdef HAVE_INOTIFY
+  for (auto& wd : _watches)
+    inotify_rm_watch (_inotify, wd);
+#endif
+
+  _watches.clear ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Clears the cache if a watched directory changed, or if one of the files
+// authentication depends on changed.  Task data written by syncs is ignored.
+void Database::readEvents ()
+{
+#ifdef HAVE_INOTIFY
+  alignas (struct inotify_event) char buffer[4096];
+  ssize_t length;
+  while ((length = read (_inotify, buffer, sizeof (buffer))) > 0)
+  {
+    for (char* p = buffer; p < buffer + length; )
+    {
+      auto event = (const struct inotify_event*) p;
+
+      // A watch is gone, either removed here, or because its directory was
+      // deleted, which has already been seen as IN_DELETE_SELF.
+      if (event->mask & IN_IGNORED)
+        _watches.erase (event->wd);
+
+      // No name means the directory itself changed, or events were lost.
+      else if (event->len == 0                      ||
+               ! strcmp (event->name, "suspended") ||
+               ! strcmp (event->name, "config")    ||
+               ! strcmp (event->name, "users"))
+        forget ();
+
+      p += sizeof (struct inotify_event) + event->len;
+    }
+  }
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool Database::verifyExistence (const Path& path, Msg& response)
 {
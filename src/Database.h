@@ -30,7 +30,10 @@
 #include <ConfigFile.h>
 #include <FS.h>
 #include <Msg.h>
-#include <Log.h>
+#include <SharedLog.h>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 class Database
 {
@@ -40,7 +43,9 @@ public:
   Database& operator= (const Database&); // Assignment operator
   ~Database ();                          // Destructor
 
-  void setLog (Log*);
+  void setLog (SharedLog*);
+  void enableCache ();
+  void invalidate ();
 
   // These throw on failure.
   bool authenticate (const Msg&, Msg&);
@@ -56,6 +61,21 @@ public:
   std::string key_generate ();
 
 private:
+  // What authentication found on disk for one org and key.
+  struct Account
+  {
+    bool        org_suspended  {false};
+    bool        user_suspended {false};
+    std::string user           {};
+  };
+
+  bool lookup (const std::string&, const std::string&, Account&, Msg&);
+  bool verify (const Account&, const std::string&, const std::string&, Msg&);
+  int watch (const std::string&);
+  void remember (int);
+  void forget ();
+  void readEvents ();
+
   bool verifyExistence  (const Path&, Msg&);
   bool verifyReadable   (const Path&, Msg&);
   bool verifyWritable   (const Path&, Msg&);
@@ -65,7 +85,12 @@ public:
   Config* _config {nullptr};
 
 private:
-  Log* _log       {nullptr};
+  SharedLog*                                 _log        {nullptr};
+  int                                        _inotify    {-1};
+  std::mutex                                 _mutex      {};
+  std::unordered_map <std::string, Account>  _accounts   {};
+  std::unordered_set <int>                   _watches    {};
+  unsigned int                               _generation {0};
 };
 
 #endif
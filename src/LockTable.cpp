@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmake.h>
+#include <Timer.h>
+#include <LockTable.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Each request takes a ticket, and waits until that ticket is served, so that
+// requests for the same name are granted strictly in arrival order.
+void LockTable::lock (const std::string& name)
+{
+  Timer timer;
+  timer.start ();
+
+  std::unique_lock <std::mutex> lock (_mutex);
+  Entry& entry = _locks[name];
+  unsigned long ticket = entry.next++;
+
+  bool contended = entry.serving != ticket;
+  entry.turn.wait (lock, [&entry, ticket] { return entry.serving == ticket; });
+
+  timer.stop ();
+  double waited = timer.total_s ();
+
+  ++_acquired;
+  if (contended)
+    ++_contended;
+
+  _wait += waited;
+  if (waited > _max_wait)
+    _max_wait = waited;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The entry is discarded when no other request is waiting for it.
+void LockTable::unlock (const std::string& name)
+{
+  std::lock_guard <std::mutex> lock (_mutex);
+  auto i = _locks.find (name);
+  if (i == _locks.end ())
+    return;
+
+  if (++i->second.serving == i->second.next)
+    _locks.erase (i);
+  else
+    i->second.turn.notify_all ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LockTable::statistics (
+  long& acquired,
+  long& contended,
+  double& wait,
+  double& max_wait)
+{
+  std::lock_guard <std::mutex> lock (_mutex);
+  acquired  = _acquired;
+  contended = _contended;
+  wait      = _wait;
+  max_wait  = _max_wait;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ScopedLock::ScopedLock (LockTable& table, const std::string& name)
+: _table (table)
+, _name (name)
+{
+  _table.lock (_name);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ScopedLock::~ScopedLock ()
+{
+  _table.unlock (_name);
+}
+
+////////////////////////////////////////////////////////////////////////////////
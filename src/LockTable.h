@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef INCLUDED_LOCKTABLE
+#define INCLUDED_LOCKTABLE
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+
+// A table of named locks, granted in the order requested.  Locks with
+// different names are independent.
+class LockTable
+{
+public:
+  void lock (const std::string&);
+  void unlock (const std::string&);
+  void statistics (long&, long&, double&, double&);
+
+private:
+  struct Entry
+  {
+    unsigned long           next    {0};  // Next ticket issued
+    unsigned long           serving {0};  // Ticket holding the lock
+    std::condition_variable turn    {};
+  };
+
+  std::mutex                     _mutex     {};
+  std::map <std::string, Entry>  _locks     {};
+  long                           _acquired  {0};
+  long                           _contended {0};
+  double                         _wait      {0.0};
+  double                         _max_wait  {0.0};
+};
+
+// Holds a lock for its lifetime.
+class ScopedLock
+{
+public:
+  ScopedLock (LockTable&, const std::string&);
+  ~ScopedLock ();
+
+private:
+  LockTable&  _table;
+  std::string _name;
+};
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+#include <cmake.h>
+#include <MergeSet.h>
+
+////////////////////////////////////////////////////////////////////////////////
+MergeSet::MergeSet (Arena& arena)
+: _subset (16, UUIDSet::hasher (), UUIDSet::key_equal (), arena)
+, _client (16, UUIDRecords::hasher (), UUIDRecords::key_equal (), arena)
+, _merged (16, UUIDSet::hasher (), UUIDSet::key_equal (), arena)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Adds the UUID of a task in the server subset.
+void MergeSet::subset (const std::string& uuid)
+{
+  _subset.insert (uuid);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Adds a client record, and the UUID of its task.
+void MergeSet::client (const std::string& uuid, unsigned int record)
+{
+  _client[uuid].push_back (record);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Whether the task is in the server subset, and so must be merged.
+bool MergeSet::contains (const std::string& uuid) const
+{
+  return _subset.count (uuid) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns true only the first time a task is reached.  Merging a task picks up
+// all of its client records, so it is merged once.
+bool MergeSet::first (const std::string& uuid)
+{
+  return _merged.insert (uuid).second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The client records of a task, in order.
+const std::vector <unsigned int>& MergeSet::records (const std::string& uuid) const
+{
+  static const std::vector <unsigned int> none;
+
+  auto i = _client.find (uuid);
+  if (i == _client.end ())
+    return none;
+
+  return i->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The number of distinct UUIDs in the server subset.
+size_t MergeSet::size () const
+{
+  return _subset.size ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef INCLUDED_MERGESET
+#define INCLUDED_MERGESET
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <Arena.h>
+
+// Hashed UUIDs, for the duration of one request.
+typedef std::unordered_set <std::string,
+                            std::hash <std::string>,
+                            std::equal_to <std::string>,
+                            ArenaAllocator <std::string>> UUIDSet;
+typedef std::unordered_map <std::string,
+                            std::vector <unsigned int>,
+                            std::hash <std::string>,
+                            std::equal_to <std::string>,
+                            ArenaAllocator <std::pair <const std::string, std::vector <unsigned int>>>> UUIDRecords;
+
+// Which client tasks of a sync must be merged: those whose UUID is in the
+// server subset, each once, with every client record of that UUID.  The UUIDs
+// are hashed once, in the request arena, so the merge loop is linear in the
+// number of tasks.
+class MergeSet
+{
+public:
+  MergeSet (Arena&);
+  MergeSet (const MergeSet&) = delete;
+  MergeSet& operator= (const MergeSet&) = delete;
+
+  void subset (const std::string&);
+  void client (const std::string&, unsigned int);
+  bool contains (const std::string&) const;
+  bool first (const std::string&);
+  const std::vector <unsigned int>& records (const std::string&) const;
+  size_t size () const;
+
+private:
+  UUIDSet     _subset;
+  UUIDRecords _client;
+  UUIDSet     _merged;
+};
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
@@ -38,6 +38,11 @@
 #include <syslog.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <random>
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
 #include <Server.h>
 #include <TLSServer.h>
 #include <Timer.h>
@@ -48,6 +53,9 @@ bool _sighup  = false;
 bool _sigusr1 = false;
 bool _sigusr2 = false;
 
+thread_local std::string Server::_client_address {""};
+thread_local int         Server::_client_port    {0};
+
 ////////////////////////////////////////////////////////////////////////////////
 static void signal_handler (int s)
 {
@@ -100,10 +108,85 @@ void Server::setQueueSize (int size)
 ////////////////////////////////////////////////////////////////////////////////
 void Server::setPoolSize (int size)
 {
+  if (size < 1)
+  {
+    if (_log) _log->write (format ("Invalid pool size {1}, using 1", size));
+    size = 1;
+  }
+
   if (_log) _log->write (format ("Thread Pool size {1}", size));
   _pool_size = size;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Keeps a connection open after a response, for up to the given number of
+// seconds, so that the client may send another request without a new
+// handshake.  No more than the given number of requests are served on one
+// connection.  A timeout of zero means one request per connection.
+void Server::setKeepAlive (int timeout, int requests)
+{
+  if (timeout < 0)
+  {
+    if (_log) _log->write (format ("Invalid keep-alive timeout {1}, using 0", timeout));
+    timeout = 0;
+  }
+
+  if (requests < 1)
+  {
+    if (_log) _log->write (format ("Invalid keep-alive request limit {1}, using 1", requests));
+    requests = 1;
+  }
+
+  if (_log && timeout) _log->write (format ("Keep-alive {1}s, up to {2} requests", timeout, requests));
+  _keepalive_timeout  = timeout;
+  _keepalive_requests = timeout ? requests : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Limits the seconds allowed for the TLS handshake, for receiving a request
+// and for sending a response, so that a slow or stalled client cannot hold on
+// to a worker.  A connection that takes longer is closed.  Zero means no limit.
+void Server::setTimeouts (int handshake, int read, int write)
+{
+  if (handshake < 0 || read < 0 || write < 0)
+  {
+    if (_log) _log->write (format ("Invalid timeouts {1}/{2}/{3}s, using 0 for negative values", handshake, read, write));
+    if (handshake < 0) handshake = 0;
+    if (read < 0)      read      = 0;
+    if (write < 0)     write     = 0;
+  }
+
+  if (_log) _log->write (format ("Timeouts handshake {1}s, read {2}s, write {3}s", handshake, read, write));
+  _handshake_timeout = handshake;
+  _read_timeout      = read;
+  _write_timeout     = write;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sheds load, by answering requests as temporarily unavailable rather than
+// handling them, while more than the given number of connections are open, or
+// for connections that waited longer than the given milliseconds for a worker.
+// Clients are told to retry after about the given number of seconds.  Zero
+// disables either threshold.
+void Server::setAdmission (int connections, int wait, int retry)
+{
+  if (connections < 0) connections = 0;
+  if (wait < 0)        wait        = 0;
+
+  if (retry < 1)
+  {
+    if (_log) _log->write (format ("Invalid admission retry {1}, using 1", retry));
+    retry = 1;
+  }
+
+  if (_log && (connections || wait))
+    _log->write (format ("Admission up to {1} connections, {2}ms wait, retry after {3}s", connections, wait, retry));
+
+  _admission_connections = connections;
+  _admission_wait        = wait;
+  _admission_retry       = retry;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void Server::setDaemon ()
 {
@@ -111,6 +194,20 @@ void Server::setDaemon ()
   _daemon = true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void Server::setBlocking ()
+{
+  if (_log) _log->write ("Using blocking I/O");
+  _blocking = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Server::setNonBlocking ()
+{
+  if (_log) _log->write ("Using non-blocking I/O");
+  _blocking = false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void Server::setPidFile (const std::string& file)
 {
@@ -175,7 +272,7 @@ void Server::setLogClients (bool value)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void Server::setLog (Log* l)
+void Server::setLog (SharedLog* l)
 {
   _log = l;
 }
@@ -186,6 +283,22 @@ void Server::setConfig (Config* c)
   _config = c;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Called on the accepting thread when SIGUSR1 was trapped, at a point where no
+// worker is servicing a request.
+void Server::reload ()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Composes the response to a request that is shed because the server is
+// overloaded, asking the client to retry after the given number of seconds.
+// Without a response, the connection is simply closed.
+void Server::reject (std::string& output, int)
+{
+  output = "";
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void Server::beginServer ()
 {
@@ -233,6 +346,33 @@ void Server::beginServer ()
 
     server.dh_bits (dh_bits);
     if (_log) _log->write (format ("Using dh_bits: {1}", dh_bits));
+
+    if (_config->get ("session.tickets") != "")
+      server.tickets (_config->getBoolean ("session.tickets"));
+
+    if (_config->get ("session.cache") != "")
+    {
+      int entries = _config->getInteger ("session.cache");
+      if (entries < 0)
+      {
+        if (_log) _log->write (format ("Invalid session.cache value, disabling session cache: {1}", entries));
+        entries = 0;
+      }
+
+      server.session_cache (entries);
+    }
+
+    if (_config->get ("session.lifetime") != "")
+    {
+      int lifetime = _config->getInteger ("session.lifetime");
+      if (lifetime < 0)
+      {
+        if (_log) _log->write (format ("Invalid session.lifetime value, disabling session resumption: {1}", lifetime));
+        lifetime = 0;
+      }
+
+      server.session_lifetime (lifetime);
+    }
   }
 
   server.init (_ca_file,        // CA
@@ -245,50 +385,711 @@ void Server::beginServer ()
 
   if (_log) _log->write ("Server ready");
 
+  if (! _blocking)
+  {
+#ifdef HAVE_EPOLL
+    serveNonBlocking (server);
+#else
+    if (_log) _log->write ("Non-blocking I/O is not supported on this platform, using blocking I/O");
+#endif
+  }
+
+  startWorkers ();
+
   _request_count = 0;
   while (1)
   {
     try
     {
-      TLSTransaction tx;
-      tx.trust (server.trust ());
-      server.accept (tx);
+      std::unique_ptr <TLSTransaction> tx (new TLSTransaction ());
+      tx->trust (server.trust ());
+      server.accept (*tx);
 
       if (_sighup)
         throw "SIGHUP shutdown.";
 
-      // Get client address and port, for logging.
-      if (_log_clients)
-        tx.getClient (_client_address, _client_port);
+      // A trapped SIGUSR1 results in a config reload, which must not happen
+      // while a worker is using the config.
+      if (_sigusr1)
+      {
+        drain ();
+        reload ();
+        _sigusr1 = false;
+      }
+
+      ++_connections;
+      dispatch (std::move (tx));
+    }
+
+    catch (std::string& e) { if (_log) _log->write (std::string ("Error: ") + e); }
+    catch (char* e)        { if (_log) _log->write (std::string ("Error: ") + e); }
+    catch (...)            { if (_log) _log->write ("Error: Unknown exception"); }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The workers are started with the handled signals blocked, so that those
+// signals are always delivered to the accepting thread.
+void Server::startWorkers ()
+{
+  sigset_t handled;
+  sigemptyset (&handled);
+  sigaddset (&handled, SIGHUP);
+  sigaddset (&handled, SIGUSR1);
+  sigaddset (&handled, SIGUSR2);
+
+  sigset_t original;
+  pthread_sigmask (SIG_BLOCK, &handled, &original);
+
+  for (int i = 0; i < _pool_size; ++i)
+    _workers.push_back (std::thread (&Server::worker, this));
+
+  pthread_sigmask (SIG_SETMASK, &original, NULL);
+
+  if (_log) _log->write (format ("Started {1} workers", _pool_size));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Server::worker ()
+{
+  while (1)
+  {
+    std::unique_ptr <TLSTransaction> tx;
+    {
+      std::unique_lock <std::mutex> lock (_pool_mutex);
+      _work_available.wait (lock, [this] { return ! _pending.empty (); });
+      tx = std::move (_pending.front ());
+      _pending.pop_front ();
+      ++_busy;
+    }
+    _pool_changed.notify_all ();
+
+    service (*tx);
+
+    // Closes the connection.
+    tx.reset ();
+    --_connections;
+
+    {
+      std::lock_guard <std::mutex> lock (_pool_mutex);
+      --_busy;
+    }
+    _pool_changed.notify_all ();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Hands an accepted connection to the workers.  No more than queue.size
+// connections wait here, beyond that they wait in the listen backlog.
+void Server::dispatch (std::unique_ptr <TLSTransaction> tx)
+{
+  std::unique_lock <std::mutex> lock (_pool_mutex);
+  _pool_changed.wait (lock, [this] { return (int) _pending.size () < _queue_size; });
+  _pending.push_back (std::move (tx));
+  lock.unlock ();
+
+  _work_available.notify_one ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Server::countHandshake (const TLSTransaction& tx)
+{
+  ++_handshakes;
+  if (tx.resumed ())
+    ++_resumed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Waits until all dispatched connections are serviced.
+void Server::drain ()
+{
+  std::unique_lock <std::mutex> lock (_pool_mutex);
+  _pool_changed.wait (lock, [this] { return _pending.empty () && _busy == 0; });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Runs on a worker thread.  With keep-alive, the connection is serviced until
+// the client closes it, stays idle too long, or reaches the request limit.
+void Server::service (TLSTransaction& tx)
+{
+  // The connection waited in the queue since it was accepted.
+  bool late = overdue (std::chrono::steady_clock::now () - tx.accepted ());
+
+  std::string phase {"handshake"};
+  try
+  {
+    tx.deadline (_handshake_timeout);
+    tx.handshake ();
+    countHandshake (tx);
+
+    // Get client address and port, for logging.
+    if (_log_clients)
+      tx.getClient (_client_address, _client_port);
+
+    for (int served = 0; served < _keepalive_requests; ++served)
+    {
+      if (served && ! tx.wait (_keepalive_timeout * 1000))
+        break;
 
       // Metrics.
       Timer timer;
       timer.start ();
 
+      phase = "receive";
+      tx.deadline (_read_timeout);
+      tx.limit (_limit);
+
       std::string input;
       tx.recv (input);
+      if (tx.closed ())
+        break;
 
       // Handle the request.
-      ++_request_count;
+      int request = ++_request_count;
 
-      // Call the derived class handler.
+      // Call the derived class handler, unless overloaded.
       std::string output;
-      handler (input, output);
-      if (output.length ())
-        tx.send (output);
+      bool admitted = admit (late && ! served);
+      if (admitted)
+        handler (input, output);
+      else
+        shed (output);
+
+      if (! output.length ())
+        break;
+
+      phase = "send";
+      tx.deadline (_write_timeout);
+      tx.send (output);
 
       if (_log)
       {
         timer.stop ();
-        _log->write (format ("[{1}] Serviced in {2}s", _request_count, (timer.total_us () / 1e6)));
+        _log->write (format ("[{1}] Serviced in {2}s", request, (timer.total_us () / 1e6)));
       }
+
+      if (! admitted)
+        break;
     }
+  }
 
-    catch (std::string& e) { if (_log) _log->write (std::string ("Error: ") + e); }
-    catch (char* e)        { if (_log) _log->write (std::string ("Error: ") + e); }
-    catch (...)            { if (_log) _log->write ("Error: Unknown exception"); }
+  catch (std::string& e)
+  {
+    if (tx.expired ())
+      countTimeout (phase);
+    else if (_log)
+      _log->write (std::string ("Error: ") + e);
   }
+
+  catch (char* e)        { if (_log) _log->write (std::string ("Error: ") + e); }
+  catch (...)            { if (_log) _log->write ("Error: Unknown exception"); }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Server::countTimeout (const std::string& phase)
+{
+  ++_timeouts;
+  if (_log) _log->write (format ("Error: Timed out during {1}", phase));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// True if a connection waited too long for a worker to start on it, which means
+// requests are queueing up.
+bool Server::overdue (std::chrono::steady_clock::duration waited) const
+{
+  return _admission_wait &&
+         waited > std::chrono::milliseconds (_admission_wait);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Decides whether a request is handled, or shed.  Only the first request on a
+// connection can be late.
+bool Server::admit (bool late) const
+{
+  if (late)
+    return false;
+
+  return ! _admission_connections ||
+         _connections <= _admission_connections;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Answers quickly, without calling the handler.  Clients that were all told to
+// retry after the same time would return together, so the hint is spread over
+// [retry, 2 * retry) seconds.
+void Server::shed (std::string& output)
+{
+  static thread_local std::minstd_rand spread {std::random_device {} ()};
+  int retry = _admission_retry + (int) (spread () % _admission_retry);
+
+  ++_shed;
+  if (_log) _log->write (format ("Overloaded, shedding request, retry after {1}s", retry));
+
+  reject (output, retry);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Server::hasDeadlines () const
+{
+  return _keepalive_timeout ||
+         _handshake_timeout ||
+         _read_timeout      ||
+         _write_timeout;
+}
+
+#ifdef HAVE_EPOLL
+////////////////////////////////////////////////////////////////////////////////
+// The state of a non-blocking connection, which is advanced by whichever worker
+// receives the readiness event for its socket.
+struct Server::Connection
+{
+  enum state { handshaking, receiving, sending };
+
+  std::unique_ptr <TLSTransaction> tx      {};
+  enum state                       state    {handshaking};
+  std::string                      input    {""};
+  int                              request  {0};
+  int                              requests {0};
+  bool                             fresh    {true};
+  Timer                            timer    {};
+
+  // When the socket must next be ready, if ever, and whether it was not.
+  std::chrono::steady_clock::time_point deadline {};
+  bool                             expired  {false};
+
+  // Whether the connection is still waiting for its first worker, whether it
+  // waited too long, and whether its request was shed.
+  bool                             queued   {true};
+  bool                             late     {false};
+  bool                             shed     {false};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// All sockets are non-blocking, and registered with a single epoll instance
+// using EPOLLONESHOT, so that a socket is only ever serviced by one worker at
+// a time.  The workers wait for readiness, and advance the handshake, receive
+// and send of any connection as far as possible without blocking, so that a
+// few workers can serve many slow clients.  This thread only handles signals.
+void Server::serveNonBlocking (TLSServer& server)
+{
+  server.blocking (false);
+
+  _epoll = epoll_create1 (0);
+  if (_epoll == -1)
+    throw std::string (::strerror (errno));
+
+  // The listening socket is identified by a null pointer.
+  struct epoll_event event {};
+  event.events   = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = nullptr;
+  if (epoll_ctl (_epoll, EPOLL_CTL_ADD, server.descriptor (), &event) == -1)
+    throw std::string (::strerror (errno));
+
+  // The workers, and this thread outside of sigsuspend, block the handled
+  // signals.
+  sigset_t handled;
+  sigemptyset (&handled);
+  sigaddset (&handled, SIGHUP);
+  sigaddset (&handled, SIGUSR1);
+  sigaddset (&handled, SIGUSR2);
+
+  sigset_t original;
+  pthread_sigmask (SIG_BLOCK, &handled, &original);
+
+  _drained = std::chrono::steady_clock::now ();
+  for (int i = 0; i < _pool_size; ++i)
+    _workers.push_back (std::thread (&Server::eventWorker, this, std::ref (server)));
+
+  if (_log) _log->write (format ("Started {1} non-blocking workers", _pool_size));
+
+  _request_count = 0;
+  while (1)
+  {
+    sigsuspend (&original);
+
+    // A trapped SIGUSR1 results in a config reload, which must not happen
+    // while a handler is using the config.
+    if (_sigusr1)
+    {
+      {
+        std::unique_lock <std::mutex> lock (_pool_mutex);
+        _reloading = true;
+        _pool_changed.wait (lock, [this] { return _busy == 0; });
+        reload ();
+        _reloading = false;
+      }
+      _pool_changed.notify_all ();
+
+      _sigusr1 = false;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Events only queue up while no worker is waiting for one, because a waiting
+// worker takes an event as soon as it is ready.  So an event that a worker
+// finds already waiting has waited no longer than since the queue was last
+// seen empty, and one that a worker has to wait for has not waited at all.
+void Server::eventWorker (TLSServer& server)
+{
+  while (1)
+  {
+    // Deadlines are checked at least once a second.
+    struct epoll_event event {};
+    int ready;
+    auto waited = std::chrono::steady_clock::duration::zero ();
+    if (_admission_wait)
+    {
+      ready = epoll_wait (_epoll, &event, 1, 0);
+      if (ready == 1)
+      {
+        std::lock_guard <std::mutex> lock (_queue_mutex);
+        if (! _sleeping)
+          waited = std::chrono::steady_clock::now () - _drained;
+      }
+      else
+      {
+        {
+          std::lock_guard <std::mutex> lock (_queue_mutex);
+          _drained = std::chrono::steady_clock::now ();
+          ++_sleeping;
+        }
+
+        ready = epoll_wait (_epoll, &event, 1, hasDeadlines () ? 1000 : -1);
+
+        {
+          std::lock_guard <std::mutex> lock (_queue_mutex);
+          _drained = std::chrono::steady_clock::now ();
+          --_sleeping;
+        }
+      }
+    }
+    else
+      ready = epoll_wait (_epoll, &event, 1, hasDeadlines () ? 1000 : -1);
+
+    if (hasDeadlines ())
+      expire ();
+
+    if (ready == -1)
+    {
+      if (errno != EINTR)
+        if (_log) _log->write (std::string ("Error: ") + ::strerror (errno));
+
+      continue;
+    }
+
+    if (ready == 0)
+      continue;
+
+    if (event.data.ptr == nullptr)
+      acceptConnections (server);
+    else
+      advance ((Connection*) event.data.ptr, waited);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Accepts all pending connections, then re-arms the listening socket.
+void Server::acceptConnections (TLSServer& server)
+{
+  while (1)
+  {
+    try
+    {
+      std::unique_ptr <TLSTransaction> tx (new TLSTransaction ());
+      tx->trust (server.trust ());
+      if (! server.accept (*tx))
+        break;
+
+      Connection* connection = new Connection ();
+      connection->tx = std::move (tx);
+
+      if (_handshake_timeout)
+      {
+        connection->deadline = std::chrono::steady_clock::now () + std::chrono::seconds (_handshake_timeout);
+        watch (connection);
+      }
+
+      struct epoll_event event {};
+      event.events   = EPOLLIN | EPOLLONESHOT;
+      event.data.ptr = connection;
+      if (epoll_ctl (_epoll, EPOLL_CTL_ADD, connection->tx->descriptor (), &event) == -1)
+      {
+        wake (connection);
+        delete connection;
+        throw std::string (::strerror (errno));
+      }
+
+      ++_connections;
+    }
+
+    catch (std::string& e) { if (_log) _log->write (std::string ("Error: ") + e); break; }
+    catch (...)            { if (_log) _log->write ("Error: Unknown exception"); break; }
+  }
+
+  struct epoll_event event {};
+  event.events   = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = nullptr;
+  if (epoll_ctl (_epoll, EPOLL_CTL_MOD, server.descriptor (), &event) == -1)
+    if (_log) _log->write (std::string ("Error: ") + ::strerror (errno));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Calls the derived class handler, unless a config reload is in progress, in
+// which case the call waits for the reload to complete.
+void Server::callHandler (const std::string& input, std::string& output)
+{
+  {
+    std::unique_lock <std::mutex> lock (_pool_mutex);
+    _pool_changed.wait (lock, [this] { return ! _reloading; });
+    ++_busy;
+  }
+
+  try
+  {
+    handler (input, output);
+  }
+
+  catch (...)
+  {
+    {
+      std::lock_guard <std::mutex> lock (_pool_mutex);
+      --_busy;
+    }
+    _pool_changed.notify_all ();
+    throw;
+  }
+
+  {
+    std::lock_guard <std::mutex> lock (_pool_mutex);
+    --_busy;
+  }
+  _pool_changed.notify_all ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Advances the connection as far as possible without blocking, then either
+// waits for the socket to be ready again, or closes the connection.  The event
+// for the socket waited for a worker for the given time.  With
+// keep-alive, a connection that has sent its response goes back to receiving.
+// Each wait is bounded by the deadline for the handshake, request or response,
+// or by the keep-alive timeout between requests.
+void Server::advance (
+  Connection* connection,
+  std::chrono::steady_clock::duration waited)
+{
+  try
+  {
+    TLSTransaction& tx = *connection->tx;
+    if (hasDeadlines ())
+      wake (connection);
+
+    // A connection idle between requests is expected to time out eventually.
+    if (connection->expired)
+    {
+      if (connection->state == Connection::handshaking)
+        countTimeout ("handshake");
+      else if (connection->state == Connection::sending)
+        countTimeout ("send");
+      else if (! connection->fresh)
+        countTimeout ("receive");
+
+      return disconnect (connection);
+    }
+
+    // A new connection cannot have waited longer than since it was accepted.
+    if (connection->queued)
+    {
+      auto accepted = std::chrono::steady_clock::now () - tx.accepted ();
+      connection->late   = overdue (waited < accepted ? waited : accepted);
+      connection->queued = false;
+    }
+
+    if (connection->state == Connection::handshaking)
+    {
+      if (! tx.try_handshake ())
+        return rearm (connection);
+
+      countHandshake (tx);
+      connection->state = Connection::receiving;
+      connection->deadline = std::chrono::steady_clock::time_point ();
+    }
+
+    while (1)
+    {
+      if (connection->state == Connection::receiving)
+      {
+        // Metrics, and the deadline, from the first activity of a request.
+        // Without a read timeout, a request that follows another must still
+        // arrive in full before the keep-alive deadline set when it finished.
+        if (connection->fresh)
+        {
+          connection->timer.start ();
+          connection->fresh = false;
+          tx.limit (_limit);
+
+          if (_read_timeout)
+            connection->deadline = std::chrono::steady_clock::now () + std::chrono::seconds (_read_timeout);
+        }
+
+        if (! tx.try_recv (connection->input))
+        {
+          if (tx.closed ())
+            return disconnect (connection);
+
+          return rearm (connection);
+        }
+
+        // Get client address and port, for logging.
+        if (_log_clients)
+          tx.getClient (_client_address, _client_port);
+
+        // Handle the request.
+        connection->request = ++_request_count;
+        ++connection->requests;
+
+        std::string output;
+        if (admit (connection->late && connection->requests == 1))
+          callHandler (connection->input, output);
+        else
+        {
+          shed (output);
+          connection->shed = true;
+        }
+
+        if (! output.length ())
+          return disconnect (connection);
+
+        tx.frame (std::move (output));
+        connection->state = Connection::sending;
+
+        if (_write_timeout)
+          connection->deadline = std::chrono::steady_clock::now () + std::chrono::seconds (_write_timeout);
+        else
+          connection->deadline = std::chrono::steady_clock::time_point ();
+      }
+
+      if (! tx.try_send ())
+        return rearm (connection);
+
+      if (_log)
+      {
+        connection->timer.stop ();
+        _log->write (format ("[{1}] Serviced in {2}s", connection->request, (connection->timer.total_us () / 1e6)));
+      }
+
+      if (connection->requests >= _keepalive_requests ||
+          connection->shed)
+        return disconnect (connection);
+
+      // The next request may already be buffered, otherwise it is awaited.
+      // Between requests, a connection may only stay idle so long.
+      connection->state    = Connection::receiving;
+      connection->fresh    = true;
+      connection->deadline = std::chrono::steady_clock::now () + std::chrono::seconds (_keepalive_timeout);
+      if (! tx.wait (0))
+        return rearm (connection, EPOLLIN);
+    }
+  }
+
+  catch (std::string& e) { if (_log) _log->write (std::string ("Error: ") + e); disconnect (connection); }
+  catch (char* e)        { if (_log) _log->write (std::string ("Error: ") + e); disconnect (connection); }
+  catch (...)            { if (_log) _log->write ("Error: Unknown exception"); disconnect (connection); }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Waits for the socket to be ready in the direction that the interrupted TLS
+// operation needs.
+void Server::rearm (Connection* connection)
+{
+  rearm (connection, connection->tx->wants_write () ? EPOLLOUT : EPOLLIN);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The connection's deadline, if any, is registered first, because after the
+// socket is re-armed, another worker may pick the connection up.
+void Server::rearm (Connection* connection, unsigned int events)
+{
+  if (connection->deadline != std::chrono::steady_clock::time_point ())
+    watch (connection);
+
+  struct epoll_event event {};
+  event.events   = events | EPOLLONESHOT;
+  event.data.ptr = connection;
+  if (epoll_ctl (_epoll, EPOLL_CTL_MOD, connection->tx->descriptor (), &event) == -1)
+    throw std::string (::strerror (errno));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Server::disconnect (Connection* connection)
+{
+  if (hasDeadlines ())
+    wake (connection);
+
+  epoll_ctl (_epoll, EPOLL_CTL_DEL, connection->tx->descriptor (), NULL);
+  delete connection;
+  --_connections;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Registers a connection that waits for its socket until its deadline.
+void Server::watch (Connection* connection)
+{
+  std::lock_guard <std::mutex> lock (_watch_mutex);
+
+  auto found = _watched.find (connection);
+  if (found != _watched.end ())
+    _deadlines.erase (found->second);
+
+  _watched[connection] = _deadlines.emplace (connection->deadline, connection);
+
+  if (connection->deadline.time_since_epoch ().count () < _earliest)
+    _earliest = connection->deadline.time_since_epoch ().count ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The worker that receives an event for a connection owns it, so it is no
+// longer watched.  The earliest deadline is left as it is, and at worst makes
+// one early call to expire recalculate it.
+void Server::wake (Connection* connection)
+{
+  std::lock_guard <std::mutex> lock (_watch_mutex);
+
+  auto found = _watched.find (connection);
+  if (found != _watched.end ())
+  {
+    _deadlines.erase (found->second);
+    _watched.erase (found);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Connections past their deadline are not closed here, because no worker owns
+// them.  Instead they are marked as expired and their sockets are shut down,
+// which wakes a worker, that disconnects them.  A registered connection is not
+// yet disconnected, so its socket is still open.  Until the earliest deadline
+// has passed, there is nothing to do, and the lock is not taken.
+void Server::expire ()
+{
+  auto now = std::chrono::steady_clock::now ();
+  if (now.time_since_epoch ().count () < _earliest)
+    return;
+
+  std::lock_guard <std::mutex> lock (_watch_mutex);
+  while (! _deadlines.empty () &&
+         _deadlines.begin ()->first <= now)
+  {
+    auto connection = _deadlines.begin ()->second;
+    connection->expired = true;
+    shutdown (connection->tx->descriptor (), SHUT_RDWR);
+    _watched.erase (connection);
+    _deadlines.erase (_deadlines.begin ());
+  }
+
+  _earliest = (_deadlines.empty () ? std::chrono::steady_clock::time_point::max ()
+                                   : _deadlines.begin ()->first).time_since_epoch ().count ();
 }
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 void Server::daemonize ()
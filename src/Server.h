@@ -28,8 +28,21 @@
 
 #include <sys/types.h>
 #include <string>
+#include <deque>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <ConfigFile.h>
-#include <Log.h>
+#include <SharedLog.h>
+
+class TLSServer;
+class TLSTransaction;
 
 class Server
 {
@@ -45,7 +58,7 @@ public:
   void setBlocking ();
   void setNonBlocking ();
   void setPidFile (const std::string&);
-  void setLog (Log*);
+  void setLog (SharedLog*);
   void setConfig (Config*);
   void setLimit (int);
   void setCAFile (const std::string&);
@@ -53,22 +66,65 @@ public:
   void setKeyFile (const std::string&);
   void setCRLFile (const std::string&);
   void setLogClients (bool);
+  void setKeepAlive (int, int);
+  void setTimeouts (int, int, int);
+  void setAdmission (int, int, int);
   void start ();
 
   void beginServer ();
 
   virtual void handler (const std::string&, std::string&) = 0;
+  virtual void reload ();
+  virtual void reject (std::string&, int);
 
 protected:
   void daemonize ();
   void writePidFile ();
   void removePidFile ();
 
-  Log* _log                    {nullptr};
+  SharedLog* _log              {nullptr};
   Config* _config              {nullptr};
   bool _log_clients            {false};
-  std::string _client_address  {""};
-  int _client_port             {0};
+
+  // Completed TLS handshakes, and how many resumed an earlier session.
+  std::atomic <long> _handshakes {0};
+  std::atomic <long> _resumed    {0};
+
+  // Connections closed because a handshake, request or response took too long.
+  std::atomic <long> _timeouts   {0};
+
+  // Requests answered with 'temporarily unavailable', because of overload.
+  std::atomic <long> _shed       {0};
+
+  // Each worker thread services one client at a time.
+  static thread_local std::string _client_address;
+  static thread_local int _client_port;
+
+private:
+  void startWorkers ();
+  void worker ();
+  void dispatch (std::unique_ptr <TLSTransaction>);
+  void drain ();
+  void service (TLSTransaction&);
+  void countHandshake (const TLSTransaction&);
+  void countTimeout (const std::string&);
+  bool hasDeadlines () const;
+  bool overdue (std::chrono::steady_clock::duration) const;
+  bool admit (bool) const;
+  void shed (std::string&);
+
+  struct Connection;
+  void serveNonBlocking (TLSServer&);
+  void eventWorker (TLSServer&);
+  void acceptConnections (TLSServer&);
+  void advance (Connection*, std::chrono::steady_clock::duration);
+  void rearm (Connection*);
+  void rearm (Connection*, unsigned int);
+  void disconnect (Connection*);
+  void watch (Connection*);
+  void wake (Connection*);
+  void expire ();
+  void callHandler (const std::string&, std::string&);
 
 private:
   std::string _host            {"::"};
@@ -77,13 +133,48 @@ private:
   int _pool_size               {4};
   int _queue_size              {10};
   bool _daemon                 {false};
+  bool _blocking               {true};
   std::string _pid_file        {""};
-  int _request_count           {0};
+  std::atomic <int> _request_count {0};
   int _limit                   {0};
   std::string _ca_file         {""};
   std::string _cert_file       {""};
   std::string _key_file        {""};
   std::string _crl_file        {""};
+  int _keepalive_timeout       {0};
+  int _keepalive_requests      {1};
+  int _handshake_timeout       {0};
+  int _read_timeout            {0};
+  int _write_timeout           {0};
+  int _admission_connections   {0};
+  int _admission_wait          {0};
+  int _admission_retry         {10};
+  std::atomic <int> _connections {0};
+
+  // Worker pool.
+  std::vector <std::thread>                     _workers        {};
+  std::deque <std::unique_ptr <TLSTransaction>> _pending        {};
+  std::mutex                                    _pool_mutex     {};
+  std::condition_variable                       _work_available {};
+  std::condition_variable                       _pool_changed   {};
+  int                                           _busy           {0};
+  bool                                          _reloading      {false};
+  int                                           _epoll          {-1};
+
+  // The number of non-blocking workers blocked waiting for events, and when
+  // there were last no events waiting.  Only kept when admission.wait is set.
+  std::mutex                                    _queue_mutex    {};
+  int                                           _sleeping       {0};
+  std::chrono::steady_clock::time_point         _drained        {};
+
+  // Non-blocking connections waiting for their socket, that must be ready
+  // before a deadline, ordered by deadline, and the earliest deadline, which
+  // is read without the lock.
+  typedef std::multimap <std::chrono::steady_clock::time_point, Connection*> Deadlines;
+  std::mutex                                    _watch_mutex    {};
+  Deadlines                                     _deadlines      {};
+  std::unordered_map <Connection*, Deadlines::iterator> _watched {};
+  std::atomic <std::chrono::steady_clock::rep>  _earliest       {std::chrono::steady_clock::time_point::max ().time_since_epoch ().count ()};
 };
 
 #endif
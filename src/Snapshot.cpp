@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmake.h>
+#include <Snapshot.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <FS.h>
+#include <Task.h>
+#include <format.h>
+
+////////////////////////////////////////////////////////////////////////////////
+Snapshot::Snapshot (const std::string& data, const std::string& file)
+: _data (data)
+, _file (file)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The file holds a "<records> <offset>" header line, then a "<uuid> <task>"
+// line per task, and finally the sync key.  A missing or stale file leaves
+// the snapshot empty, so that it is rebuilt from all data.
+void Snapshot::load ()
+{
+  std::vector <std::string> lines;
+  if (! File::read (_file, lines) ||
+      lines.size () < 2)
+    return;
+
+  _records = (unsigned int) strtoul  (lines[0].c_str (), nullptr, 10);
+  _offset  = (off_t)        strtoull (lines[0].c_str () + lines[0].find (' '), nullptr, 10);
+
+  for (unsigned int i = 1; i < lines.size () - 1; ++i)
+  {
+    auto space = lines[i].find (' ');
+    if (space == std::string::npos)
+      break;
+
+    auto uuid = lines[i].substr (0, space);
+    _uuids[uuid] = _tasks.size ();
+    _tasks.push_back (std::make_pair (uuid, lines[i].substr (space + 1)));
+  }
+
+  _key = lines.back ();
+
+  if (_tasks.size () != lines.size () - 2 ||
+      ! verify ())
+  {
+    _offset = 0;
+    _records = 0;
+    _tasks.clear ();
+    _uuids.clear ();
+    _key = "";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Applies the records that follow the offset, without their newlines.
+void Snapshot::apply (const std::vector <std::string>& records)
+{
+  for (auto& record : records)
+  {
+    if (record[0] == '{')
+    {
+      auto uuid = Task (record).get ("uuid");
+      auto i = _uuids.find (uuid);
+      if (i == _uuids.end ())
+      {
+        _uuids[uuid] = _tasks.size ();
+        _tasks.push_back (std::make_pair (uuid, record));
+      }
+      else
+        _tasks[i->second].second = record;
+    }
+    else
+      _key = record;
+
+    _offset += record.length () + 1;
+    ++_records;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Snapshot::save () const
+{
+  std::string contents = std::to_string (_records) + ' ' + std::to_string (_offset) + '\n';
+  for (auto& task : _tasks)
+    contents += task.first + ' ' + task.second + '\n';
+
+  contents += _key + '\n';
+
+  std::string temp = _file + ".tmp";
+  int fd = ::open (temp.c_str (), O_WRONLY | O_TRUNC | O_CREAT, 0600);
+  if (fd == -1)
+    throw format ("Could not open '{1}': {2}", temp, strerror (errno));
+
+  auto status = ::write (fd, contents.data (), contents.length ());
+  int error = errno;
+  ::close (fd);
+
+  if (status != (ssize_t) contents.length ())
+  {
+    ::unlink (temp.c_str ());
+    throw format ("Could not write '{1}': {2}", temp, strerror (error));
+  }
+
+  if (::rename (temp.c_str (), _file.c_str ()))
+  {
+    error = errno;
+    ::unlink (temp.c_str ());
+    throw format ("Could not rename '{1}': {2}", temp, strerror (error));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The latest version of each task, followed by the sync key, as they would be
+// found in the data.
+void Snapshot::latest (std::vector <std::string>& records) const
+{
+  for (auto& task : _tasks)
+    records.push_back (task.second);
+
+  if (_key != "")
+    records.push_back (_key);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+off_t Snapshot::offset () const
+{
+  return _offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned int Snapshot::records () const
+{
+  return _records;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Every append ends with a sync key, so the key must immediately precede the
+// offset in the data, otherwise the data has been changed behind the snapshot.
+bool Snapshot::verify () const
+{
+  if (_key == "" ||
+      _offset <= (off_t) _key.length ())
+    return false;
+
+  int fd = ::open (_data.c_str (), O_RDONLY);
+  if (fd == -1)
+    return false;
+
+  std::string buffer (_key.length () + 1, '\0');
+  auto status = ::pread (fd, &buffer[0], buffer.length (), _offset - buffer.length ());
+  ::close (fd);
+
+  return status == (ssize_t) buffer.length () &&
+         buffer == _key + '\n';
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef INCLUDED_SNAPSHOT
+#define INCLUDED_SNAPSHOT
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <sys/types.h>
+
+// The latest version of every task in a user's tx.data, and the current sync
+// key, as of a known offset into the data.  It is brought up to date by
+// applying the records appended since then.
+class Snapshot
+{
+public:
+  Snapshot (const std::string&, const std::string&);
+  void load ();
+  void apply (const std::vector <std::string>&);
+  void save () const;
+  void latest (std::vector <std::string>&) const;
+  off_t offset () const;
+  unsigned int records () const;
+
+private:
+  bool verify () const;
+
+private:
+  std::string                                         _data;
+  std::string                                         _file;
+  off_t                                               _offset  {0};
+  unsigned int                                        _records {0};
+  std::vector <std::pair <std::string, std::string>>  _tasks   {};  // UUID, task
+  std::unordered_map <std::string, unsigned int>      _uuids   {};  // Into _tasks
+  std::string                                         _key     {};
+};
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,213 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmake.h>
+#include <SyncIndex.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <format.h>
+
+// Each entry is "<key> <offset> <record>\n", with fixed-width fields.
+static const int KEY_WIDTH    = 36;
+static const int ENTRY_WIDTH  = KEY_WIDTH + 1 + 20 + 1 + 10 + 1;
+static const int ENTRIES_READ = 64;
+
+////////////////////////////////////////////////////////////////////////////////
+static std::string composeEntry (
+  const std::string& key,
+  off_t offset,
+  unsigned int record)
+{
+  char entry[ENTRY_WIDTH + 1];
+  snprintf (entry, sizeof (entry), "%s %020llu %010u\n",
+            key.c_str (), (unsigned long long) offset, record);
+  return std::string (entry, ENTRY_WIDTH);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SyncIndex::SyncIndex (const std::string& data, const std::string& index)
+: _data (data)
+, _index (index)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Searches from the most recent entry backwards, because clients that sync
+// regularly hold one of the most recent keys.  Returns false if the key is
+// not indexed, or if the index does not agree with the data, in which case
+// the caller falls back to scanning the data, and rebuilds the index.
+bool SyncIndex::find (
+  const std::string& key,
+  off_t& offset,
+  unsigned int& record) const
+{
+  if (key.length () != KEY_WIDTH)
+    return false;
+
+  int fd = ::open (_index.c_str (), O_RDONLY);
+  if (fd == -1)
+    return false;
+
+  struct stat st;
+  if (::fstat (fd, &st) ||
+      st.st_size % ENTRY_WIDTH)
+  {
+    ::close (fd);
+    return false;
+  }
+
+  bool found = false;
+  char buffer[ENTRY_WIDTH * ENTRIES_READ];
+  off_t end = st.st_size;
+  while (end > 0 && ! found)
+  {
+    off_t start = end - ENTRY_WIDTH * ENTRIES_READ;
+    if (start < 0)
+      start = 0;
+
+    if (::pread (fd, buffer, end - start, start) != end - start)
+      break;
+
+    for (int i = (end - start) / ENTRY_WIDTH - 1; i >= 0; --i)
+    {
+      const char* entry = buffer + i * ENTRY_WIDTH;
+      if (key.compare (0, KEY_WIDTH, entry, KEY_WIDTH) == 0)
+      {
+        offset = (off_t) strtoull (entry + KEY_WIDTH + 1, nullptr, 10);
+        record = (unsigned int) strtoul (entry + KEY_WIDTH + 22, nullptr, 10);
+        found = true;
+        break;
+      }
+    }
+
+    end = start;
+  }
+
+  ::close (fd);
+  return found && verify (key, offset);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Indexes the keys among records just appended to the data at the given
+// offset, where the first of them is the given record number.
+void SyncIndex::add (
+  const std::vector <std::string>& records,
+  off_t offset,
+  unsigned int record) const
+{
+  std::string entries;
+  for (auto& line : records)
+  {
+    if (line[0] != '{')
+    {
+      std::string key = line.substr (0, line.find ('\n'));
+      if (key.length () != KEY_WIDTH)
+        return;
+
+      entries += composeEntry (key, offset, record);
+    }
+
+    offset += line.length ();
+    ++record;
+  }
+
+  int fd = ::open (_index.c_str (), O_WRONLY | O_APPEND | O_CREAT, 0600);
+  if (fd == -1)
+    throw format ("Could not open '{1}': {2}", _index, strerror (errno));
+
+  auto status = ::write (fd, entries.data (), entries.length ());
+  int error = errno;
+  ::close (fd);
+
+  // A partial entry is detected by find, which then causes a rebuild.
+  if (status != (ssize_t) entries.length ())
+    throw format ("Could not write '{1}': {2}", _index, strerror (error));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Replaces the index with one covering all of the given data, which holds
+// records without their newline terminators.
+void SyncIndex::rebuild (const std::vector <std::string>& data) const
+{
+  std::string entries;
+  off_t offset = 0;
+  unsigned int record = 0;
+  for (auto& line : data)
+  {
+    if (line[0] != '{' &&
+        line.length () == KEY_WIDTH)
+      entries += composeEntry (line, offset, record);
+
+    offset += line.length () + 1;
+    ++record;
+  }
+
+  std::string temp = _index + ".tmp";
+  int fd = ::open (temp.c_str (), O_WRONLY | O_TRUNC | O_CREAT, 0600);
+  if (fd == -1)
+    throw format ("Could not open '{1}': {2}", temp, strerror (errno));
+
+  auto status = ::write (fd, entries.data (), entries.length ());
+  int error = errno;
+  ::close (fd);
+
+  if (status != (ssize_t) entries.length ())
+  {
+    ::unlink (temp.c_str ());
+    throw format ("Could not write '{1}': {2}", temp, strerror (error));
+  }
+
+  if (::rename (temp.c_str (), _index.c_str ()))
+  {
+    error = errno;
+    ::unlink (temp.c_str ());
+    throw format ("Could not rename '{1}': {2}", temp, strerror (error));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Confirms that the key is present in the data at the given offset.
+bool SyncIndex::verify (const std::string& key, off_t offset) const
+{
+  int fd = ::open (_data.c_str (), O_RDONLY);
+  if (fd == -1)
+    return false;
+
+  char buffer[KEY_WIDTH + 1];
+  auto status = ::pread (fd, buffer, KEY_WIDTH + 1, offset);
+  ::close (fd);
+
+  return status == KEY_WIDTH + 1                           &&
+         key.compare (0, KEY_WIDTH, buffer, KEY_WIDTH) == 0 &&
+         buffer[KEY_WIDTH] == '\n';
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,54 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef INCLUDED_SYNCINDEX
+#define INCLUDED_SYNCINDEX
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// An index of the sync keys in a user's tx.data, giving the byte offset and
+// record number of each key.  Entries are fixed-width lines, so the most
+// recent keys are found by reading only the end of the index.
+class SyncIndex
+{
+public:
+  SyncIndex (const std::string&, const std::string&);
+  bool find (const std::string&, off_t&, unsigned int&) const;
+  void add (const std::vector <std::string>&, off_t, unsigned int) const;
+  void rebuild (const std::vector <std::string>&) const;
+
+private:
+  bool verify (const std::string&, off_t) const;
+
+private:
+  std::string _data;
+  std::string _index;
+};
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
@@ -45,6 +45,8 @@
 #include <sys/errno.h>
 #endif
 #include <sys/types.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <netdb.h>
 #include <gnutls/x509.h>
 #include <format.h>
@@ -59,6 +61,20 @@ static int verify_certificate_callback (gnutls_session_t);
 #endif
 #endif
 
+////////////////////////////////////////////////////////////////////////////////
+// Blocking sockets are read and written through the transaction, so that it can
+// enforce its deadline.
+static ssize_t transport_pull (gnutls_transport_ptr_t ptr, void* data, size_t size)
+{
+  return ((TLSTransaction*) ptr)->pull (data, size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static ssize_t transport_push (gnutls_transport_ptr_t ptr, const giovec_t* iov, int count)
+{
+  return ((TLSTransaction*) ptr)->push (iov, count);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 static void gnutls_log_function (int level, const char* message)
 {
@@ -89,6 +105,9 @@ TLSServer::~TLSServer ()
   if (_credentials)
     gnutls_certificate_free_credentials (_credentials);
 
+  if (_ticket_key.data)
+    gnutls_free (_ticket_key.data); // All
+
   if(_priorities && _priorities_init)
     gnutls_priority_deinit (_priorities);
 
@@ -163,6 +182,30 @@ void TLSServer::dh_bits (unsigned int dh_bits)
   _dh_bits = dh_bits;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Session tickets let a returning client resume its session, skipping the
+// certificate exchange and key agreement, with no state kept on the server.
+void TLSServer::tickets (bool value)
+{
+  _tickets = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The number of sessions kept on the server, for clients that resume by
+// session ID rather than by ticket.  Zero means no cache.
+void TLSServer::session_cache (unsigned int entries)
+{
+  _session_cache = entries;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// How long, in seconds, a session may be resumed.  This is also how often the
+// ticket key changes.  Zero means no resumption.
+void TLSServer::session_lifetime (unsigned int seconds)
+{
+  _session_lifetime = seconds;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void TLSServer::init (
   const std::string& ca,
@@ -340,12 +383,178 @@ void TLSServer::listen ()
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void TLSServer::accept (TLSTransaction& tx)
+// A non-blocking server socket also results in non-blocking connections.
+void TLSServer::blocking (bool value)
+{
+  _blocking = value;
+
+  int flags = fcntl (_socket, F_GETFL, 0);
+  if (flags == -1 ||
+      fcntl (_socket, F_SETFL, value ? flags & ~O_NONBLOCK : flags | O_NONBLOCK) == -1)
+    throw std::string (::strerror (errno));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int TLSServer::descriptor () const
+{
+  return _socket;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Allows a new session to be resumed later, and to resume an earlier one.
+//
+// From GnuTLS 3.6.4 the ticket key is a master key, from which GnuTLS derives
+// a new key every session lifetime, while still accepting tickets made with
+// the previous one.  So the master key is generated once, and a ticket can be
+// redeemed for its whole lifetime, while a stolen derived key is only useful
+// for a limited time.
+//
+// Older versions use the key as given, and accept no other, so it is replaced
+// once it is older than the session lifetime, and tickets issued with the old
+// key fall back to a full handshake.
+void TLSServer::resumption (gnutls_session_t session)
+{
+  if (! _session_lifetime)
+    return;
+
+  gnutls_db_set_cache_expiration (session, _session_lifetime); // All
+
+  if (_tickets)
+  {
+    std::lock_guard <std::mutex> lock (_session_mutex);
+#if GNUTLS_VERSION_NUMBER >= 0x030604
+    if (! _ticket_key.data)
+#else
+    auto now = time (NULL);
+    if (! _ticket_key.data ||
+        now - _ticket_key_time >= (time_t) _session_lifetime)
+#endif
+    {
+      if (_ticket_key.data)
+        gnutls_free (_ticket_key.data); // All
+
+      _ticket_key = {};
+      int ret = gnutls_session_ticket_key_generate (&_ticket_key); // 2.10.0
+      if (ret < 0)
+        throw format ("TLS session ticket error. {1}", gnutls_strerror (ret)); // All
+
+#if GNUTLS_VERSION_NUMBER < 0x030604
+      _ticket_key_time = now;
+#endif
+    }
+
+    // The key is copied into the session.
+    int ret = gnutls_session_ticket_enable_server (session, &_ticket_key); // 2.10.0
+    if (ret < 0)
+      throw format ("TLS session ticket error. {1}", gnutls_strerror (ret)); // All
+  }
+
+  if (_session_cache)
+  {
+    gnutls_db_set_retrieve_function (session, cache_retrieve); // All
+    gnutls_db_set_store_function (session, cache_store); // All
+    gnutls_db_set_remove_function (session, cache_remove); // All
+    gnutls_db_set_ptr (session, this); // All
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Stores a session, evicting the oldest when the cache is full.  A session
+// stored again replaces the earlier copy, and becomes the newest.
+int TLSServer::cache_store (void* ptr, gnutls_datum_t key, gnutls_datum_t data)
+{
+  auto server = (TLSServer*) ptr;
+  std::string id ((const char*) key.data, key.size);
+  std::string stored ((const char*) data.data, data.size);
+
+  std::lock_guard <std::mutex> lock (server->_session_mutex);
+  auto found = server->_sessions.find (id);
+  if (found != server->_sessions.end ())
+  {
+    found->second.data = stored;
+    found->second.stored = time (NULL);
+    server->_session_order.splice (server->_session_order.end (),
+                                   server->_session_order,
+                                   found->second.order);
+    return 0;
+  }
+
+  while (! server->_session_order.empty () &&
+         server->_session_order.size () >= server->_session_cache)
+  {
+    server->_sessions.erase (server->_session_order.front ());
+    server->_session_order.pop_front ();
+  }
+
+  auto order = server->_session_order.insert (server->_session_order.end (), id);
+  server->_sessions[id] = {stored, time (NULL), order};
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns a copy of the stored session, which GnuTLS frees, or nothing if the
+// session is unknown or expired.
+gnutls_datum_t TLSServer::cache_retrieve (void* ptr, gnutls_datum_t key)
+{
+  auto server = (TLSServer*) ptr;
+  std::string id ((const char*) key.data, key.size);
+  gnutls_datum_t data {};
+
+  std::lock_guard <std::mutex> lock (server->_session_mutex);
+  auto found = server->_sessions.find (id);
+  if (found == server->_sessions.end ())
+    return data;
+
+  if (time (NULL) - found->second.stored >= (time_t) server->_session_lifetime)
+  {
+    server->forget (found);
+    return data;
+  }
+
+  auto& stored = found->second.data;
+  data.data = (unsigned char*) gnutls_malloc (stored.length ()); // All
+  if (data.data)
+  {
+    memcpy (data.data, stored.data (), stored.length ());
+    data.size = stored.length ();
+  }
+
+  return data;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int TLSServer::cache_remove (void* ptr, gnutls_datum_t key)
+{
+  auto server = (TLSServer*) ptr;
+  std::string id ((const char*) key.data, key.size);
+
+  std::lock_guard <std::mutex> lock (server->_session_mutex);
+  auto found = server->_sessions.find (id);
+  if (found == server->_sessions.end ())
+    return -1;
+
+  server->forget (found);
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Drops a cached session, and its place in the eviction order.  The caller
+// holds _session_mutex.
+void TLSServer::forget (Sessions::iterator found)
+{
+  _session_order.erase (found->second.order);
+  _sessions.erase (found);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Returns false if the server is non-blocking, and there is no pending
+// connection.
+bool TLSServer::accept (TLSTransaction& tx)
 {
   if (_debug)
     tx.debug ();
 
-  tx.init (*this);
+  return tx.init (*this);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -362,7 +571,7 @@ TLSTransaction::~TLSTransaction ()
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void TLSTransaction::init (TLSServer& server)
+bool TLSTransaction::init (TLSServer& server)
 {
   int ret = gnutls_init (&_session, GNUTLS_SERVER); // All
   if (ret < 0)
@@ -384,6 +593,9 @@ void TLSTransaction::init (TLSServer& server)
   // Require client certificate.
   gnutls_certificate_server_set_request (_session, GNUTLS_CERT_REQUIRE); // All
 
+  // Allow the session to be resumed.
+  server.resumption (_session);
+
 /*
   // Set maximum compatibility mode. This is only suggested on public
   // webservers that need to trade security for compatibility
@@ -396,10 +608,29 @@ void TLSTransaction::init (TLSServer& server)
   {
     _socket = accept (server._socket, (struct sockaddr *) &sa_cli, &client_len);
   }
-  while (errno == EINTR);
+  while (_socket < 0 && errno == EINTR);
 
   if (_socket < 0)
+  {
+    if (! server._blocking &&
+        (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      _socket = 0;
+      return false;
+    }
+
     throw std::string (::strerror (errno));
+  }
+
+  _accepted = std::chrono::steady_clock::now ();
+
+  if (! server._blocking)
+  {
+    int flags = fcntl (_socket, F_GETFL, 0);
+    if (flags == -1 ||
+        fcntl (_socket, F_SETFL, flags | O_NONBLOCK) == -1)
+      throw std::string (::strerror (errno));
+  }
 
   // Obtain client info.
   char topbuf[512];
@@ -412,18 +643,49 @@ void TLSTransaction::init (TLSServer& server)
               << _port
               << '\n';
 
+  if (server._blocking)
+  {
+    gnutls_transport_set_ptr (_session, (gnutls_transport_ptr_t) this); // All
+    gnutls_transport_set_pull_function (_session, transport_pull); // All
+    gnutls_transport_set_vec_push_function (_session, transport_push); // 2.12.0
+  }
+  else
+  {
 #if GNUTLS_VERSION_NUMBER >= 0x030109
-  gnutls_transport_set_int (_session, _socket); // 3.1.9
+    gnutls_transport_set_int (_session, _socket); // 3.1.9
 #else
-  gnutls_transport_set_ptr (_session, (gnutls_transport_ptr_t) (intptr_t) _socket); // All
+    gnutls_transport_set_ptr (_session, (gnutls_transport_ptr_t) (intptr_t) _socket); // All
 #endif
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Performs the TLS handshake on an accepted connection.
+void TLSTransaction::handshake ()
+{
+  while (! try_handshake ())
+    ;
+}
 
-  // Perform the TLS handshake
+////////////////////////////////////////////////////////////////////////////////
+// Performs as much of the TLS handshake as possible without blocking.  Returns
+// true when the handshake is complete, and false if it must be resumed when the
+// socket is ready.
+bool TLSTransaction::try_handshake ()
+{
+  int ret;
   do
   {
     ret = gnutls_handshake (_session); // All
   }
-  while (ret < 0 && gnutls_error_is_fatal (ret) == 0); // All
+  while (ret < 0 &&
+         ret != GNUTLS_E_AGAIN &&
+         gnutls_error_is_fatal (ret) == 0); // All
+
+  if (ret == GNUTLS_E_AGAIN)
+    return false;
 
   if (ret < 0)
   {
@@ -439,9 +701,8 @@ void TLSTransaction::init (TLSServer& server)
       std::string error {(const char*) out.data};
       throw format ("Handshake failed for host '{2}'. {1}", error, _address);
     }
-#else
-    throw format ("Handshake failed for host '{2}'. {1}", gnutls_strerror (ret), _address); // All
 #endif
+    throw format ("Handshake failed for host '{2}'. {1}", gnutls_strerror (ret), _address); // All
   }
 
 #if GNUTLS_VERSION_NUMBER < 0x02090a
@@ -468,6 +729,15 @@ void TLSTransaction::init (TLSServer& server)
     std::cout << "s: INFO Handshake was completed.\n";
 #endif
   }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// True if the handshake resumed an earlier session.
+bool TLSTransaction::resumed () const
+{
+  return gnutls_session_is_resumed (_session) != 0; // All
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -491,6 +761,7 @@ void TLSTransaction::trust (const enum TLSServer::trust_level value)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
+// The most bytes of a message body that are kept.  Zero means no limit.
 void TLSTransaction::limit (int max)
 {
   _limit = max;
@@ -598,91 +869,211 @@ int TLSTransaction::verify_certificate () const
 }
 
 ////////////////////////////////////////////////////////////////////////////////
+// Sends the message directly from data, which is not copied.
 void TLSTransaction::send (const std::string& data)
 {
-  std::string packet = "XXXX" + data;
+  prepare (data.data (), data.length ());
+  while (! try_send ())
+    ;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Prepares a message for try_send, taking over the contents of data, so that
+// it need not be copied.
+void TLSTransaction::frame (std::string&& data)
+{
+  _outgoing = std::move (data);
+  prepare (_outgoing.data (), _outgoing.length ());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The message is sent from where it is, with its encoded length, which counts
+// itself, held separately.
+void TLSTransaction::prepare (const char* data, unsigned long length)
+{
+  _data   = data;
+  _length = length;
+  _sent   = 0;
 
   // Encode the length.
-  unsigned long l = packet.length ();
-  packet[0] = l >>24;
-  packet[1] = l >>16;
-  packet[2] = l >>8;
-  packet[3] = l;
+  unsigned long l = HEADER_SIZE + length;
+  _frame[0] = l >>24;
+  _frame[1] = l >>16;
+  _frame[2] = l >>8;
+  _frame[3] = l;
+}
 
-  unsigned int total = 0;
+////////////////////////////////////////////////////////////////////////////////
+// Sends as much of the framed message as possible without blocking.  Returns
+// true when the whole message is sent, and false if it must be resumed when the
+// socket is ready.
+bool TLSTransaction::try_send ()
+{
+  unsigned long total = HEADER_SIZE + _length;
 
-  int status;
-  do
+#if GNUTLS_VERSION_NUMBER >= 0x030109
+  // The header is corked together with the start of the message, to fill the
+  // first record, rather than sending the header in a record of its own.  The
+  // rest is sent from the message itself, one full record at a time.
+  if (_sent == 0)
   {
-    status = gnutls_record_send (_session, packet.c_str () + total, packet.length () - total); // All
+    unsigned long first = _length < MAX_BUF - HEADER_SIZE ? _length : MAX_BUF - HEADER_SIZE;
+
+    gnutls_record_cork (_session); // 3.1.9
+    _corked = true;
+
+    int status = gnutls_record_send (_session, _frame, HEADER_SIZE); // All
+    if (status >= 0 && first)
+      status = gnutls_record_send (_session, _data, first); // All
+    if (status < 0)
+      throw std::string (gnutls_strerror (status)); // All
+
+    _sent = HEADER_SIZE + first;
+  }
+
+  while (_corked)
+  {
+    int status = gnutls_record_uncork (_session, 0); // 3.1.9
+    if (status >= 0)
+      _corked = false;
+    else if (status == GNUTLS_E_AGAIN)
+      return false;
+    else if (status != GNUTLS_E_INTERRUPTED)
+      throw std::string (gnutls_strerror (status)); // All
+  }
+#endif
+
+  while (_sent < total)
+  {
+    const char* from;
+    unsigned long count;
+    if (_sent < HEADER_SIZE)
+    {
+      from  = (const char*) _frame + _sent;
+      count = HEADER_SIZE - _sent;
+    }
+    else
+    {
+      from  = _data + (_sent - HEADER_SIZE);
+      count = total - _sent;
+    }
+
+    int status = gnutls_record_send (_session, from, count); // All
+    if (status > 0)
+      _sent += status;
+    else if (status == GNUTLS_E_AGAIN)
+      return false;
+    else if (status != GNUTLS_E_INTERRUPTED)
+      throw std::string (gnutls_strerror (status)); // All
   }
-  while ((status > 0 && (total += status) < packet.length ()) ||
-          status == GNUTLS_E_INTERRUPTED ||
-          status == GNUTLS_E_AGAIN);
 
   if (_debug)
     std::cout << "s: INFO Sending 'XXXX"
-              << data.c_str ()
-              << "' (" << total << " bytes)"
+              << std::string (_data, _length)
+              << "' (" << _sent << " bytes)"
               << std::endl;
+
+  _outgoing.clear ();
+  _outgoing.shrink_to_fit ();
+  _data = nullptr;
+  _length = 0;
+  _sent = 0;
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void TLSTransaction::recv (std::string& data)
 {
-  data = "";          // No appending of data.
+  while (! try_recv (data) && ! _closed)
+    ;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Receives as much of a message as possible without blocking.  Returns true
+// when the whole message is received, and false if it must be resumed when the
+// socket is ready, in which case data holds the partial message.  Also returns
+// false if the peer closed the connection instead of sending another message,
+// which is then indicated by closed ().
+bool TLSTransaction::try_recv (std::string& data)
+{
   int received = 0;
-  int total = 0;
 
   // Get the encoded length.
-  unsigned char header[HEADER_SIZE] {};
-  do
+  if (_received < HEADER_SIZE)
   {
-    received = gnutls_record_recv (_session, header + total, HEADER_SIZE - total); // All
-  }
-  while ((received > 0 && (total += received) < HEADER_SIZE) ||
-          received == GNUTLS_E_INTERRUPTED ||
-          received == GNUTLS_E_AGAIN);
+    if (_received == 0)
+      data = "";      // No appending of data.
 
-  if (total < HEADER_SIZE) {
-    throw std::string ("Failed to receive header: ") +
-        (received < 0 ? gnutls_strerror(received) : "connection lost?");
-  }
+    while (_received < HEADER_SIZE)
+    {
+      received = gnutls_record_recv (_session, _header + _received, HEADER_SIZE - _received); // All
+      if (received > 0)
+        _received += received;
+      else if (received == GNUTLS_E_AGAIN)
+        return false;
+      else if (_received == 0 &&
+               (received == 0
+#ifdef GNUTLS_E_PREMATURE_TERMINATION
+                || received == GNUTLS_E_PREMATURE_TERMINATION
+#endif
+               ))
+      {
+        _closed = true;
+        return false;
+      }
+      else if (received != GNUTLS_E_INTERRUPTED)
+        throw std::string ("Failed to receive header: ") +
+            (received < 0 ? gnutls_strerror(received) : "connection lost?");
+    }
 
-  // Decode the length.
-  unsigned long expected = (header[0]<<24) |
-                           (header[1]<<16) |
-                           (header[2]<<8) |
-                            header[3];
-  if (_debug)
-    std::cout << "s: INFO expecting " << expected << " bytes.\n";
+    // Decode the length.
+    _expected = (_header[0]<<24) |
+                (_header[1]<<16) |
+                (_header[2]<<8) |
+                 _header[3];
+    if (_debug)
+      std::cout << "s: INFO expecting " << _expected << " bytes.\n";
 
-  if (_limit && expected >= (unsigned long) _limit) {
-    std::ostringstream err_str;
-    err_str << "Expected message size " << expected << " is larger than allowed limit " << _limit;
-    throw err_str.str ();
+    // The size includes the header, so anything smaller is not a message.
+    if (_expected < HEADER_SIZE)
+      throw format ("Invalid message size {1}", _expected);
   }
 
-  // Arbitrary buffer size.
-  char buffer[MAX_BUF];
-
-  // Keep reading until no more data.  Concatenate chunks of data if a) the
-  // read was interrupted by a signal, and b) if there is more data than
-  // fits in the buffer.
-  do
+  // Read each chunk straight into place, rather than through a buffer.  A body
+  // larger than the limit is still read in full, to keep the connection in
+  // step, but only the first limit bytes are kept, which is enough for the
+  // handler to reject it.  The kept part is reserved up front, unless there is
+  // no limit and the claimed size is large, in which case the string grows as
+  // data arrives.
+  unsigned long length = _expected - HEADER_SIZE;
+  unsigned long keep = (_limit && length > (unsigned long) _limit) ? _limit : length;
+  if (data.capacity () < keep && (_limit || keep <= MAX_BUF * 64))
+    data.reserve (keep);
+
+  // Keep reading until no more data.  Read in chunks if a) the read was
+  // interrupted by a signal, and b) if there is more data than one record.
+  // Never read beyond the end of this message.
+  while ((unsigned long) _received < _expected)
   {
-    int chunk_size = 0;
-    do
+    unsigned long count = _expected - _received;
+    if (count > MAX_BUF)
+      count = MAX_BUF;
+
+    char discard[MAX_BUF];
+    char* into = discard;
+    unsigned long offset = data.length ();
+    if (offset < keep)
     {
-      received = gnutls_record_recv (_session, buffer + chunk_size, MAX_BUF - chunk_size); // All
-      if (received > 0) {
-        total += received;
-        chunk_size += received;
-      }
+      if (count > keep - offset)
+        count = keep - offset;
+
+      data.resize (offset + count);
+      into = &data[offset];
     }
-    while ((received > 0 && (unsigned long) total < expected && chunk_size < MAX_BUF) ||
-            received == GNUTLS_E_INTERRUPTED ||
-            received == GNUTLS_E_AGAIN);
+
+    received = gnutls_record_recv (_session, into, count); // All
+    if (into != discard)
+      data.resize (offset + (received > 0 ? received : 0));
 
     // Other end closed the connection.
     if (received == 0)
@@ -692,23 +1083,157 @@ void TLSTransaction::recv (std::string& data)
       break;
     }
 
+    if (received == GNUTLS_E_AGAIN)
+      return false;
+
+    if (received == GNUTLS_E_INTERRUPTED)
+      continue;
+
     // Something happened.
     if (received < 0)
       throw std::string (gnutls_strerror (received)); // All
 
-    data.append (buffer, chunk_size);
-
-    // Stop at defined limit.
-    if (_limit && total > _limit)
-      break;
+    _received += received;
   }
-  while (received > 0 && total < (int) expected);
 
   if (_debug)
     std::cout << "s: INFO Receiving 'XXXX"
               << data.c_str ()
-              << "' (" << total << " bytes)"
+              << "' (" << _received << " bytes)"
               << std::endl;
+
+  _received = 0;
+  _expected = 0;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool TLSTransaction::closed () const
+{
+  return _closed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Waits up to the given number of milliseconds for another message to begin,
+// or for the peer to close the connection.  Returns false on timeout.
+bool TLSTransaction::wait (int timeout)
+{
+  if (gnutls_record_check_pending (_session) > 0) // All
+    return true;
+
+  struct pollfd ready {};
+  ready.fd     = _socket;
+  ready.events = POLLIN;
+
+  int status;
+  do
+  {
+    status = poll (&ready, 1, timeout);
+  }
+  while (status == -1 && errno == EINTR);
+
+  if (status == -1)
+    throw std::string (::strerror (errno));
+
+  return status > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// When the connection was accepted, from which its wait for a worker is known.
+std::chrono::steady_clock::time_point TLSTransaction::accepted () const
+{
+  return _accepted;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Subsequent blocking I/O must complete within the given number of seconds,
+// rather than wait for a slow or stalled client indefinitely.  Zero means no
+// deadline.
+void TLSTransaction::deadline (int seconds)
+{
+  if (seconds > 0)
+    _deadline = std::chrono::steady_clock::now () + std::chrono::seconds (seconds);
+  else
+    _deadline = std::chrono::steady_clock::time_point ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// True if blocking I/O failed because the deadline passed.
+bool TLSTransaction::expired () const
+{
+  return _expired;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ssize_t TLSTransaction::pull (void* data, size_t size)
+{
+  if (! await (POLLIN))
+    return -1;
+
+  return ::recv (_socket, data, size, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes gathered buffers with one call, as GnuTLS does by default, so that the
+// records of a handshake flight are not held back by Nagle's algorithm.
+ssize_t TLSTransaction::push (const giovec_t* iov, int count)
+{
+  if (! await (POLLOUT))
+    return -1;
+
+  struct msghdr message {};
+  message.msg_iov    = (struct iovec*) iov;
+  message.msg_iovlen = count;
+
+#ifdef MSG_NOSIGNAL
+  return ::sendmsg (_socket, &message, MSG_NOSIGNAL);
+#else
+  return ::sendmsg (_socket, &message, 0);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Waits until the socket is ready for the given events, or the deadline passes,
+// in which case errno is set to ETIMEDOUT, and GnuTLS fails the operation.
+bool TLSTransaction::await (short events)
+{
+  if (_deadline == std::chrono::steady_clock::time_point ())
+    return true;
+
+  struct pollfd ready {};
+  ready.fd     = _socket;
+  ready.events = events;
+
+  int status;
+  do
+  {
+    auto remaining = std::chrono::duration_cast <std::chrono::milliseconds> (_deadline - std::chrono::steady_clock::now ()).count ();
+    status = remaining > 0 ? poll (&ready, 1, (int) remaining) : 0;
+  }
+  while (status == -1 && errno == EINTR);
+
+  if (status == 0)
+  {
+    _expired = true;
+    errno = ETIMEDOUT;
+    return false;
+  }
+
+  return status > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Indicates whether the last interrupted operation is waiting for the socket to
+// become writable, rather than readable.
+bool TLSTransaction::wants_write () const
+{
+  return gnutls_record_get_direction (_session) == 1; // All
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int TLSTransaction::descriptor () const
+{
+  return _socket;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -29,6 +29,11 @@
 #ifdef HAVE_LIBGNUTLS
 
 #include <string>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <chrono>
+#include <time.h>
 #include <gnutls/gnutls.h>
 
 class TLSTransaction;
@@ -46,13 +51,34 @@ public:
   void trust (const enum trust_level);
   void ciphers (const std::string&);
   void dh_bits (unsigned int dh_bits);
+  void tickets (bool);
+  void session_cache (unsigned int);
+  void session_lifetime (unsigned int);
   void init (const std::string&, const std::string&, const std::string&, const std::string&);
   void bind (const std::string&, const std::string&, const std::string&);
   void listen ();
-  void accept (TLSTransaction&);
+  void blocking (bool);
+  int descriptor () const;
+  bool accept (TLSTransaction&);
 
   friend class TLSTransaction;
 
+private:
+  // A cached session, and its place in the eviction order.
+  struct Session
+  {
+    std::string                      data;
+    time_t                           stored;
+    std::list <std::string>::iterator order;
+  };
+  typedef std::unordered_map <std::string, Session> Sessions;
+
+  void resumption (gnutls_session_t);
+  static int cache_store (void*, gnutls_datum_t, gnutls_datum_t);
+  static gnutls_datum_t cache_retrieve (void*, gnutls_datum_t);
+  static int cache_remove (void*, gnutls_datum_t);
+  void forget (Sessions::iterator);
+
 private:
   std::string                      _ca          {""};
   std::string                      _crl         {""};
@@ -67,6 +93,17 @@ private:
   bool                             _debug       {false};
   enum trust_level                 _trust       {TLSServer::strict};
   bool                             _priorities_init {false};
+  bool                             _blocking    {true};
+
+  // Session resumption, by ticket and by server-side cache.
+  bool                             _tickets          {true};
+  unsigned int                     _session_cache    {0};
+  unsigned int                     _session_lifetime {3600};
+  std::mutex                       _session_mutex    {};
+  gnutls_datum_t                   _ticket_key       {};
+  time_t                           _ticket_key_time  {0};
+  Sessions                         _sessions         {};
+  std::list <std::string>          _session_order    {};
 };
 
 class TLSTransaction
@@ -74,24 +111,60 @@ class TLSTransaction
 public:
   TLSTransaction () = default;
   ~TLSTransaction ();
-  void init (TLSServer&);
+  bool init (TLSServer&);
+  void handshake ();
+  bool try_handshake ();
+  bool resumed () const;
   void bye ();
   void debug ();
   void trust (const enum TLSServer::trust_level);
   void limit (int);
   int verify_certificate () const;
   void send (const std::string&);
+  void frame (std::string&&);
+  bool try_send ();
+  void prepare (const char*, unsigned long);
   void recv (std::string&);
+  bool try_recv (std::string&);
+  bool closed () const;
+  bool wait (int);
+  std::chrono::steady_clock::time_point accepted () const;
+  void deadline (int);
+  bool expired () const;
+  ssize_t pull (void*, size_t);
+  ssize_t push (const giovec_t*, int);
+  bool wants_write () const;
+  int descriptor () const;
   void getClient (std::string&, int&);
 
 private:
-  int                         _socket  {0};
-  gnutls_session_t            _session {};
-  int                         _limit   {0};
-  bool                        _debug   {false};
-  std::string                 _address {""};
-  int                         _port    {0};
-  enum TLSServer::trust_level _trust   {TLSServer::strict};
+  int                         _socket    {0};
+  gnutls_session_t            _session   {};
+  int                         _limit     {0};
+  bool                        _debug     {false};
+  std::string                 _address   {""};
+  int                         _port      {0};
+  enum TLSServer::trust_level _trust     {TLSServer::strict};
+  std::chrono::steady_clock::time_point _accepted {};
+
+  // Progress of a message being received or sent.
+  unsigned char               _header[4] {};
+  int                         _received  {0};
+  unsigned long               _expected  {0};
+  bool                        _closed    {false};
+  unsigned char               _frame[4]  {};
+  std::string                 _outgoing  {""};
+  const char*                 _data      {nullptr};
+  unsigned long               _length    {0};
+  unsigned long               _sent      {0};
+  bool                        _corked    {false};
+
+  // Blocking I/O fails once the deadline passes.
+  std::chrono::steady_clock::time_point _deadline {};
+  bool                        _expired   {false};
+
+private:
+  bool await (short);
 };
 
 #endif
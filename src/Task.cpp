@@ -69,7 +69,6 @@ std::string Task::defaultDue       = "";
 std::string Task::defaultScheduled = "";
 bool Task::searchCaseSensitive     = true;
 bool Task::regex                   = false;
-std::map <std::string, std::string> Task::attributes;
 
 std::map <std::string, float> Task::coefficients;
 float Task::urgencyProjectCoefficient     = 0.0;
@@ -88,6 +87,156 @@ std::map <std::string, std::vector <std::string>> Task::customOrder;
 
 static const std::string dummy ("");
 
+// The types of the built-in attributes, corrected as of 2.3.0.
+//
+// The table is laid out by attributeSlot, which is a perfect hash for these
+// names, as checked at compile time.  It is never modified, so it is safe to
+// share between threads.
+//
+// Note: annotation_* fields are missing, and are assumed to be 'string'
+// Note: UDA fields are missing, and are assumed to be 'string'
+enum attributeKind {kindNone, kindString, kindDate, kindNumeric, kindDuration};
+
+static const std::string attributeKinds[] = {"", "string", "date", "numeric", "duration"};
+
+struct AttributeEntry
+{
+  const char*   name;
+  attributeKind kind;
+};
+
+static constexpr unsigned int ATTRIBUTE_SLOTS = 30;
+
+static constexpr AttributeEntry attributeTable[ATTRIBUTE_SLOTS] =
+{
+  {nullptr,       kindNone},      //  0
+  {nullptr,       kindNone},      //  1
+  {nullptr,       kindNone},      //  2
+  {nullptr,       kindNone},      //  3
+  {nullptr,       kindNone},      //  4
+  {"wait",        kindDate},      //  5
+  {nullptr,       kindNone},      //  6
+  {"due",         kindDate},      //  7
+  {"until",       kindDate},      //  8
+  {nullptr,       kindNone},      //  9
+  {nullptr,       kindNone},      // 10
+  {"status",      kindString},    // 11
+  {"tags",        kindString},    // 12
+  {nullptr,       kindNone},      // 13
+  {"scheduled",   kindDate},      // 14
+  {"uuid",        kindString},    // 15
+  {"parent",      kindString},    // 16
+  {"project",     kindString},    // 17
+  {"imask",       kindNumeric},   // 18
+  {nullptr,       kindNone},      // 19
+  {nullptr,       kindNone},      // 20
+  {"description", kindString},    // 21
+  {"entry",       kindDate},      // 22
+  {"recur",       kindDuration},  // 23
+  {"start",       kindDate},      // 24
+  {"modified",    kindDate},      // 25
+  {"end",         kindDate},      // 26
+  {"depends",     kindString},    // 27
+  {"priority",    kindString},    // 28
+  {"mask",        kindString},    // 29
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static constexpr unsigned int attributeSlot (
+  unsigned char first,
+  unsigned char last,
+  unsigned int length)
+{
+  return (first * 3 + last * 14 + length) % ATTRIBUTE_SLOTS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static constexpr unsigned int literalLength (const char* text)
+{
+  return *text ? 1 + literalLength (text + 1) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static constexpr bool attributeTableValid (unsigned int slot)
+{
+  return slot == ATTRIBUTE_SLOTS ||
+         ((attributeTable[slot].name == nullptr ||
+           attributeSlot (attributeTable[slot].name[0],
+                          attributeTable[slot].name[literalLength (attributeTable[slot].name) - 1],
+                          literalLength (attributeTable[slot].name)) == slot) &&
+          attributeTableValid (slot + 1));
+}
+
+static_assert (attributeTableValid (0), "Every attribute must be in its attributeSlot.");
+
+////////////////////////////////////////////////////////////////////////////////
+// Looks up the type of an attribute, which is blank for unknown names.
+static const std::string& attributeType (const std::string& name)
+{
+  if (name.empty ())
+    return dummy;
+
+  auto& entry = attributeTable[attributeSlot (name[0], name.back (), name.length ())];
+  if (entry.name && name == entry.name)
+    return attributeKinds[entry.kind];
+
+  return dummy;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Dates arrive as 'YYYYMMDDTHHMMSSZ' and are stored as epoch strings, so the
+// common forms are converted directly, and only the rest go through Datetime.
+static std::string epochString (const std::string& text)
+{
+  time_t epoch;
+  if (isoToEpoch (text, epoch))
+    return std::to_string ((long long) epoch);
+
+  return Datetime (text).toEpochString ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes into iso, whose capacity is reused from one date to the next.
+static void isoString (const std::string& text, std::string& iso)
+{
+  if (! epochToISO (text, iso))
+    iso = Datetime (text).toISO ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Appends the comma-separated list as a JSON array of strings, with the same
+// elements as split (list, ','): an empty list has none, and an empty last
+// element is dropped.
+static void appendList (std::string& out, const std::string& list)
+{
+  out += '[';
+
+  std::string::size_type start = 0;
+  std::string::size_type comma;
+  while ((comma = list.find (',', start)) != std::string::npos)
+  {
+    if (start)
+      out += ',';
+
+    out += '"';
+    out.append (list, start, comma - start);
+    out += '"';
+    start = comma + 1;
+  }
+
+  if (start < list.length ())
+  {
+    if (start)
+      out += ',';
+
+    out += '"';
+    out.append (list, start, std::string::npos);
+    out += '"';
+  }
+
+  out += ']';
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // The uuid and id attributes must be exempt from comparison.
 //
@@ -268,7 +417,7 @@ time_t Task::get_date (const std::string& name) const
 ////////////////////////////////////////////////////////////////////////////////
 void Task::set (const std::string& name, const std::string& value)
 {
-  data[name] = json::decode (value);
+  data[name] = jsonDecode (value);
 
   if (! name.compare (0, 11, "annotation_", 11))
     ++annotation_count;
@@ -605,7 +754,7 @@ void Task::parse (const std::string& input)
             if (! name.compare (0, 11, "annotation_", 11))
               ++annotation_count;
 
-            data[name] = decode (json::decode (value));
+            data[name] = decode (jsonDecode (value));
           }
 
           attLine.skip (' ');
@@ -631,10 +780,152 @@ void Task::parse (const std::string& input)
   recalc_urgency = true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// A top-level value in a JSON task, as scanned by parseJSONStream.  Strings are
+// held raw, as json::string holds them, and other scalars as json::value dumps
+// them.
+struct JSONField
+{
+  enum kind {scalar, string, strings, annotations};
+
+  kind                                                type  {scalar};
+  std::string                                         text  {};
+  std::vector <std::string>                           items {};
+  std::vector <std::pair <std::string, std::string>>  annos {};  // Entry, description
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// An annotation is an object whose 'entry' and 'description' are strings.
+// Returns false for any other object.
+static bool scanAnnotation (Pig& pig, std::pair <std::string, std::string>& anno)
+{
+  bool entry = false;
+  bool description = false;
+
+  if (! pig.skip ('{'))
+    return false;
+
+  pig.skipWS ();
+  std::string name;
+  std::string value;
+  if (pig.getQuoted ('"', name))
+  {
+    while (true)
+    {
+      pig.skipWS ();
+      if (! pig.skip (':'))
+        return false;
+
+      pig.skipWS ();
+      if (! pig.getQuoted ('"', value))
+        return false;
+
+      // As with json::object, the first of duplicate names is kept.
+      if (name == "entry" && ! entry)
+      {
+        anno.first = value;
+        entry = true;
+      }
+      else if (name == "description" && ! description)
+      {
+        anno.second = value;
+        description = true;
+      }
+
+      pig.skipWS ();
+      if (! pig.skip (','))
+        break;
+
+      pig.skipWS ();
+      if (! pig.getQuoted ('"', name))
+        return false;
+    }
+  }
+
+  return pig.skip ('}') && entry && description;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Scans one top-level value.  Returns false for values that the streaming
+// parser does not handle, which are left to the full parser.
+static bool scanValue (Pig& pig, JSONField& field)
+{
+  double number;
+
+  if (pig.getQuoted ('"', field.text))
+    field.type = JSONField::string;
+
+  // Arrays of strings, or of annotations.
+  else if (pig.skip ('['))
+  {
+    field.type = JSONField::strings;
+    pig.skipWS ();
+    if (pig.peek () == '{')
+    {
+      field.type = JSONField::annotations;
+      std::pair <std::string, std::string> anno;
+      while (true)
+      {
+        if (! scanAnnotation (pig, anno))
+          return false;
+
+        field.annos.push_back (anno);
+        pig.skipWS ();
+        if (! pig.skip (','))
+          break;
+
+        pig.skipWS ();
+      }
+    }
+    else
+    {
+      std::string item;
+      if (pig.getQuoted ('"', item))
+      {
+        while (true)
+        {
+          field.items.push_back (item);
+          pig.skipWS ();
+          if (! pig.skip (','))
+            break;
+
+          pig.skipWS ();
+          if (! pig.getQuoted ('"', item))
+            return false;
+        }
+      }
+    }
+
+    return pig.skip (']');
+  }
+
+  else if (pig.getNumber (number))
+    field.text = format ("{1}", number);
+
+  else if (pig.skipLiteral ("null"))
+    field.text = "null";
+
+  else if (pig.skipLiteral ("false"))
+    field.text = "false";
+
+  else if (pig.skipLiteral ("true"))
+    field.text = "true";
+
+  else
+    return false;
+
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Note that all fields undergo encode/decode.
 void Task::parseJSON (const std::string& line)
 {
+  // Well-formed tasks are read directly from the input, and anything else is
+  // parsed in full, which also reports the errors.
+  if (parseJSONStream (line))
+    return;
+
   // Parse the whole thing.
   json::value* root = json::parse (line);
   if (root &&
@@ -644,6 +935,171 @@ void Task::parseJSON (const std::string& line)
   delete root;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Fills the task in one pass over the input, without building a json::value
+// tree, and applies the fields exactly as parseJSON (const json::object*)
+// does: first of duplicate names kept, in name order.  Returns false, having
+// changed nothing, for input it does not handle.
+bool Task::parseJSONStream (const std::string& line)
+{
+  Pig pig (line);
+  pig.skipWS ();
+  if (! pig.skip ('{'))
+    return false;
+
+  std::map <std::string, JSONField> fields;
+  pig.skipWS ();
+  std::string name;
+  if (pig.getQuoted ('"', name))
+  {
+    while (true)
+    {
+      pig.skipWS ();
+      if (! pig.skip (':'))
+        return false;
+
+      pig.skipWS ();
+      JSONField field;
+      if (! scanValue (pig, field))
+        return false;
+
+      // Arrays are only understood where parseJSON expects them, and
+      // annotations only as an array.
+      bool column = attributeType (name) != "";
+      bool expected;
+      if (field.type == JSONField::strings)
+        expected = column ? name == "tags" || name == "depends" || name == "id" || name == "urgency"
+                          : name == "annotations" && field.items.empty ();
+      else if (field.type == JSONField::annotations)
+        expected = ! column && name == "annotations";
+      else
+        expected = column || name != "annotations";
+
+      if (! expected)
+        return false;
+
+      // As with json::object, the first of duplicate names is kept.
+      fields.insert (std::make_pair (name, field));
+
+      pig.skipWS ();
+      if (! pig.skip (','))
+        break;
+
+      pig.skipWS ();
+      if (! pig.getQuoted ('"', name))
+        return false;
+    }
+  }
+
+  if (! pig.skip ('}'))
+    return false;
+
+  pig.skipWS ();
+  if (! pig.eos ())
+    return false;
+
+  for (auto& i : fields)
+  {
+    auto& field = i.second;
+
+    // If the attribute is a recognized column.
+    std::string type = attributeType (i.first);
+    if (type != "")
+    {
+      // Any specified id is ignored.
+      if (i.first == "id")
+        ;
+
+      // Urgency, if present, is ignored.
+      else if (i.first == "urgency")
+        ;
+
+      // TW-1274 Standardization.
+      else if (i.first == "modification")
+      {
+        set ("modified", epochString (field.text));
+      }
+
+      // Dates are converted from ISO to epoch.
+      else if (type == "date")
+      {
+        auto& text = field.text;
+        set (i.first, text == "" ? "" : epochString (text));
+      }
+
+      // Tags are an array of JSON strings.
+      else if (i.first == "tags" && field.type == JSONField::strings)
+      {
+        for (auto& tag : field.items)
+          addTag (tag);
+      }
+
+      // Mirakel sync sends a single string.
+      else if (i.first == "tags" && field.type == JSONField::string)
+        addTag (field.text);
+
+      // Dependencies can be exported as an array of strings.
+      else if (i.first == "depends" && field.type == JSONField::strings)
+      {
+        for (auto& dep : field.items)
+          addDependency (dep);
+      }
+
+      // Dependencies can be exported as a single comma-separated string.
+      else if (i.first == "depends" && field.type == JSONField::string)
+      {
+        auto uuids = split (field.text, ',');
+
+        for (const auto& uuid : uuids)
+          addDependency (uuid);
+      }
+
+      // Strings are decoded.
+      else if (type == "string")
+        set (i.first, jsonDecode (field.text));
+
+      // Other types are simply added.
+      else
+        set (i.first, field.text);
+    }
+
+    // UDA orphans and annotations do not have columns.
+    else
+    {
+      // Annotations are an array of JSON objects with 'entry' and
+      // 'description' values and must be converted.
+      if (i.first == "annotations")
+      {
+        std::map <std::string, std::string> annos;
+        for (auto& anno : field.annos)
+        {
+          std::string name = "annotation_" + epochString (anno.first);
+          annos.insert (std::make_pair (name, jsonDecode (anno.second)));
+        }
+
+        setAnnotations (annos);
+      }
+
+      // UDA Orphan - must be preserved.
+      else
+      {
+#ifdef PRODUCT_TASKWARRIOR
+        std::stringstream message;
+        message << "Task::parseJSON found orphan '"
+                << i.first
+                << "' with value '"
+                << field.text
+                << "' --> preserved\n";
+        Context::getContext ().debug (message.str ());
+#endif
+        set (i.first, jsonDecode (field.text));
+      }
+    }
+  }
+
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void Task::parseJSON (const json::object* root_obj)
 {
@@ -651,7 +1107,7 @@ void Task::parseJSON (const json::object* root_obj)
   for (auto& i : root_obj->_data)
   {
     // If the attribute is a recognized column.
-    std::string type = Task::attributes[i.first];
+    std::string type = attributeType (i.first);
     if (type != "")
     {
       // Any specified id is ignored.
@@ -665,16 +1121,14 @@ void Task::parseJSON (const json::object* root_obj)
       // TW-1274 Standardization.
       else if (i.first == "modification")
       {
-        Datetime d (Lexer::dequote (i.second->dump ()));
-        set ("modified", d.toEpochString ());
+        set ("modified", epochString (Lexer::dequote (i.second->dump ())));
       }
 
       // Dates are converted from ISO to epoch.
       else if (type == "date")
       {
         auto text = Lexer::dequote (i.second->dump ());
-        Datetime d (text);
-        set (i.first, text == "" ? "" : d.toEpochString ());
+        set (i.first, text == "" ? "" : epochString (text));
       }
 
       // Tags are an array of JSON strings.
@@ -724,7 +1178,7 @@ void Task::parseJSON (const json::object* root_obj)
 
       // Strings are decoded.
       else if (type == "string")
-        set (i.first, json::decode (Lexer::dequote (i.second->dump ())));
+        set (i.first, jsonDecode (Lexer::dequote (i.second->dump ())));
 
       // Other types are simply added.
       else
@@ -753,8 +1207,8 @@ void Task::parseJSON (const json::object* root_obj)
           if (! what)
             throw format ("Annotation is missing a description: {1}", root_obj->dump ());
 
-          std::string name = "annotation_" + Datetime (when->_data).toEpochString ();
-          annos.insert (std::make_pair (name, json::decode (what->_data)));
+          std::string name = "annotation_" + epochString (when->_data);
+          annos.insert (std::make_pair (name, jsonDecode (what->_data)));
         }
 
         setAnnotations (annos);
@@ -772,7 +1226,7 @@ void Task::parseJSON (const json::object* root_obj)
                 << "' --> preserved\n";
         Context::getContext ().debug (message.str ());
 #endif
-        set (i.first, json::decode (Lexer::dequote (i.second->dump ())));
+        set (i.first, jsonDecode (Lexer::dequote (i.second->dump ())));
       }
     }
   }
@@ -825,7 +1279,7 @@ std::string Task::composeF4 () const
   for (auto it : data)
   {
     // Orphans have no type, treat as string.
-    std::string type = Task::attributes[it.first];
+    std::string type = attributeType (it.first);
     if (type == "")
       type = "string";
 
@@ -836,7 +1290,7 @@ std::string Task::composeF4 () const
       ff4 += it.first;
       ff4 += ":\"";
       if (type == "string")
-        ff4 += encode (json::encode (it.second));
+        ff4 += encode (jsonEncode (it.second));
       else
         ff4 += it.second;
       ff4 += '"';
@@ -852,15 +1306,30 @@ std::string Task::composeF4 () const
 ////////////////////////////////////////////////////////////////////////////////
 std::string Task::composeJSON (bool decorate /*= false*/) const
 {
-  std::stringstream out;
-  out << '{';
+  std::string out;
+  composeJSON (out, decorate);
+  return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Appends to out, so that callers composing many tasks can reuse one buffer.
+void Task::composeJSON (std::string& out, bool decorate /*= false*/) const
+{
+  // Room for a typical task, to avoid regrowing as attributes are appended.
+  out.reserve (out.length () + 512);
+  out += '{';
 
   // ID inclusion is optional, but not a good idea, because it remains correct
   // only until the next gc.
   if (decorate)
-    out << "\"id\":" << id << ',';
+  {
+    out += "\"id\":";
+    out += std::to_string (id);
+    out += ',';
+  }
 
   // First the non-annotations.
+  std::string iso;
   int attributes_written = 0;
   for (auto& i : data)
   {
@@ -873,22 +1342,23 @@ std::string Task::composeJSON (bool decorate /*= false*/) const
         continue;
 
     if (attributes_written)
-      out << ',';
+      out += ',';
 
-    std::string type = Task::attributes[i.first];
-    if (type == "")
-      type = "string";
+    auto& type = attributeType (i.first);
 
     // Date fields are written as ISO 8601.
     if (type == "date")
     {
-      Datetime d (i.second);
-      out << '"'
-          << (i.first == "modification" ? "modified" : i.first)
-          << "\":\""
-          // Date was deleted, do not export parsed empty string
-          << (i.second == "" ? "" : d.toISO ())
-          << '"';
+      // Date was deleted, do not export parsed empty string
+      if (i.second == "")
+        iso = "";
+      else
+        isoString (i.second, iso);
+      out += '"';
+      out += (i.first == "modification" ? "modified" : i.first);
+      out += "\":\"";
+      out += iso;
+      out += '"';
 
       ++attributes_written;
     }
@@ -901,10 +1371,10 @@ std::string Task::composeJSON (bool decorate /*= false*/) const
 */
     else if (type == "numeric")
     {
-      out << '"'
-          << i.first
-          << "\":"
-          << i.second;
+      out += '"';
+      out += i.first;
+      out += "\":";
+      out += i.second;
 
       ++attributes_written;
     }
@@ -912,20 +1382,8 @@ std::string Task::composeJSON (bool decorate /*= false*/) const
     // Tags are converted to an array.
     else if (i.first == "tags")
     {
-      auto tags = split (i.second, ',');
-
-      out << "\"tags\":[";
-
-      int count = 0;
-      for (auto i : tags)
-      {
-        if (count++)
-          out << ',';
-
-        out << '"' << i << '"';
-      }
-
-      out << ']';
+      out += "\"tags\":";
+      appendList (out, i.second);
       ++attributes_written;
     }
 
@@ -951,31 +1409,22 @@ std::string Task::composeJSON (bool decorate /*= false*/) const
 #endif
             )
     {
-      auto deps = split (i.second, ',');
-
-      out << "\"depends\":[";
-
-      int count = 0;
-      for (auto i : deps)
-      {
-        if (count++)
-          out << ',';
-
-        out << '"' << i << '"';
-      }
-
-      out << ']';
+      out += "\"depends\":";
+      appendList (out, i.second);
       ++attributes_written;
     }
 
-    // Everything else is a quoted value.
+    // Everything else is a quoted value.  Unknown attributes are strings.
     else
     {
-      out << '"'
-          << i.first
-          << "\":\""
-          << (type == "string" ? json::encode (i.second) : i.second)
-          << '"';
+      out += '"';
+      out += i.first;
+      out += "\":\"";
+      if (type == "string" || type == "")
+        jsonEncode (out, i.second);
+      else
+        out += i.second;
+      out += '"';
 
       ++attributes_written;
     }
@@ -984,8 +1433,7 @@ std::string Task::composeJSON (bool decorate /*= false*/) const
   // Now the annotations, if any.
   if (annotation_count)
   {
-    out << ','
-        << "\"annotations\":[";
+    out += ",\"annotations\":[";
 
     int annotations_written = 0;
     for (auto& i : data)
@@ -993,32 +1441,34 @@ std::string Task::composeJSON (bool decorate /*= false*/) const
       if (! i.first.compare (0, 11, "annotation_", 11))
       {
         if (annotations_written)
-          out << ',';
+          out += ',';
 
-        Datetime d (i.first.substr (11));
-        out << "{\"entry\":\""
-            << d.toISO ()
-            << "\",\"description\":\""
-            << json::encode (i.second)
-            << "\"}";
+        isoString (i.first.substr (11), iso);
+        out += "{\"entry\":\"";
+        out += iso;
+        out += "\",\"description\":\"";
+        jsonEncode (out, i.second);
+        out += "\"}";
 
         ++annotations_written;
       }
     }
 
-    out << ']';
+    out += ']';
   }
 
 #ifdef PRODUCT_TASKWARRIOR
   // Include urgency.
   if (decorate)
-    out << ','
-        << "\"urgency\":"
-        << urgency_c ();
+  {
+    char urgency[32];
+    snprintf (urgency, sizeof (urgency), "%g", urgency_c ());
+    out += ",\"urgency\":";
+    out += urgency;
+  }
 #endif
 
-  out << '}';
-  return out.str ();
+  out += '}';
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1056,7 +1506,7 @@ void Task::addAnnotation (const std::string& description)
   }
   while (has (key));
 
-  data[key] = json::decode (description);
+  data[key] = jsonDecode (description);
   ++annotation_count;
   recalc_urgency = true;
 }
@@ -1071,10 +1521,10 @@ void Task::removeAnnotations ()
     if (! i->first.compare (0, 11, "annotation_", 11))
     {
       --annotation_count;
-      data.erase (i++);
+      i = data.erase (i);
     }
     else
-      i++;
+      ++i;
   }
 
   recalc_urgency = true;
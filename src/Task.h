@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <time.h>
 #include <JSON.h>
+#include <Attributes.h>
 
 class Task
 {
@@ -42,7 +43,6 @@ public:
   static std::string defaultScheduled;
   static bool searchCaseSensitive;
   static bool regex;
-  static std::map <std::string, std::string> attributes;  // name -> type
   static std::map <std::string, float> coefficients;
   static std::map <std::string, std::vector <std::string>> customOrder;
   static float urgencyProjectCoefficient;
@@ -66,6 +66,7 @@ public:
   void parse (const std::string&);
   std::string composeF4 () const;
   std::string composeJSON (bool decorate = false) const;
+  void composeJSON (std::string&, bool decorate = false) const;
 
   // Status values.
   enum status {pending, completed, deleted, recurring, waiting};
@@ -74,7 +75,7 @@ public:
   enum dateState {dateNotDue, dateAfterToday, dateLaterToday, dateEarlierToday, dateBeforeToday};
 
   // Public data.
-  std::map <std::string, std::string> data {};
+  Attributes data                          {};
   int id                                   {0};
   float urgency_value                      {0.0};
   bool recalc_urgency                      {true};
@@ -165,6 +166,7 @@ public:
 private:
   int determineVersion (const std::string&);
   void parseJSON (const std::string&);
+  bool parseJSONStream (const std::string&);
   void parseJSON (const json::object*);
   void parseLegacy (const std::string&);
   void validate_before (const std::string&, const std::string&);
@@ -0,0 +1,191 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+#include <cmake.h>
+#include <TxData.h>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <format.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Truncates a failed append back to the original size, and closes the file.
+// Returns a note for the error message if the truncation also failed.
+static std::string rollback (int fd, off_t size, const std::string& file)
+{
+  std::string note;
+  if (::ftruncate (fd, size))
+    note = format (", and could not truncate '{1}': {2}", file, strerror (errno));
+
+  ::close (fd);
+  return note;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TxData::TxData (const std::string& file)
+: _file (file)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Adds the records that follow the given byte offset to data, without their
+// newlines, and returns the number of bytes of interrupted append removed.
+off_t TxData::load (off_t offset, std::vector <std::string>& data) const
+{
+  int fd = ::open (_file.c_str (), O_RDONLY | O_CREAT, 0600);
+  if (fd == -1)
+    throw format ("Could not open '{1}': {2}", _file, strerror (errno));
+
+  struct stat st;
+  if (::fstat (fd, &st))
+  {
+    int error = errno;
+    ::close (fd);
+    throw format ("Could not stat '{1}': {2}", _file, strerror (error));
+  }
+
+  std::string contents;
+  if (st.st_size > offset)
+  {
+    contents.resize (st.st_size - offset);
+    std::string::size_type got = 0;
+    while (got < contents.length ())
+    {
+      auto status = ::pread (fd, &contents[got], contents.length () - got, offset + got);
+      if (status == -1)
+      {
+        if (errno == EINTR)
+          continue;
+
+        int error = errno;
+        ::close (fd);
+        throw format ("Could not read '{1}': {2}", _file, strerror (error));
+      }
+
+      if (status == 0)
+      {
+        contents.resize (got);
+        break;
+      }
+
+      got += status;
+    }
+  }
+
+  ::close (fd);
+
+  // Every append is a batch of task records followed by a sync key, each with
+  // a trailing newline.  So anything after the last complete key belongs to an
+  // interrupted append: task records whose key was never written, and perhaps
+  // a torn record after the last newline.  It is removed, so that a sync is
+  // all or nothing, and the next append starts after a key.  The offset is
+  // always just after a key, so only that append is scanned.
+  std::string::size_type length = 0;
+  auto end = contents.rfind ('\n');
+  while (end != std::string::npos)
+  {
+    auto start = (end == 0 ? std::string::npos : contents.rfind ('\n', end - 1));
+    start = (start == std::string::npos ? 0 : start + 1);
+    if (contents[start] != '{')
+    {
+      length = end + 1;
+      break;
+    }
+
+    end = (start == 0 ? std::string::npos : start - 1);
+  }
+
+  if (length < contents.length ())
+    if (::truncate (_file.c_str (), offset + length))
+      throw format ("Could not truncate '{1}': {2}", _file, strerror (errno));
+
+  data.reserve (data.size () + std::count (contents.begin (), contents.begin () + length, '\n'));
+  std::string::size_type start = 0;
+  while (start < length)
+  {
+    end = contents.find ('\n', start);
+    data.emplace_back (contents, start, end - start);
+    start = end + 1;
+  }
+
+  return contents.length () - length;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Appends records, which arrive newline-terminated, and flushes them to disk.
+// Should the write fail part way, for example when there is no disk space, the
+// file is truncated back to its original length, so there are no partial
+// records.  A crash mid-write leaves an incomplete batch, which load removes.
+// Returns the byte offset of the first new record.
+off_t TxData::append (const std::vector <std::string>& data) const
+{
+  std::string buffer;
+  for (auto& line : data)
+    buffer += line;
+
+  int fd = ::open (_file.c_str (), O_WRONLY | O_APPEND | O_CREAT, 0600);
+  if (fd == -1)
+    throw format ("Could not open '{1}': {2}", _file, strerror (errno));
+
+  struct stat st;
+  if (::fstat (fd, &st))
+  {
+    int error = errno;
+    ::close (fd);
+    throw format ("Could not stat '{1}': {2}", _file, strerror (error));
+  }
+
+  std::string::size_type written = 0;
+  while (written < buffer.length ())
+  {
+    auto status = ::write (fd, buffer.data () + written, buffer.length () - written);
+    if (status == -1)
+    {
+      if (errno == EINTR)
+        continue;
+
+      int error = errno;
+      auto rolled = rollback (fd, st.st_size, _file);
+      throw format ("Could not write '{1}': {2}", _file, strerror (error)) + rolled;
+    }
+
+    written += status;
+  }
+
+  if (::fsync (fd))
+  {
+    int error = errno;
+    auto rolled = rollback (fd, st.st_size, _file);
+    throw format ("Could not sync '{1}': {2}", _file, strerror (error)) + rolled;
+  }
+
+  ::close (fd);
+  return st.st_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
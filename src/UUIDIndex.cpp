@@ -0,0 +1,352 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmake.h>
+#include <UUIDIndex.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <Task.h>
+#include <format.h>
+
+// Each entry is "<uuid> <offset> <length> <record>\n", with fixed-width fields.
+static const int UUID_WIDTH  = 36;
+static const int ENTRY_WIDTH = UUID_WIDTH + 1 + 20 + 1 + 10 + 1 + 10 + 1;
+
+////////////////////////////////////////////////////////////////////////////////
+// Only a full UUID fits the fixed-width field, and a blank one marks a record
+// that is not a task.  Anything else would be padded or cut short, and then
+// not found, or found for the wrong task.
+static bool indexable (const std::string& uuid)
+{
+  return uuid == "" || uuid.length () == UUID_WIDTH;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static std::string composeEntry (
+  const std::string& uuid,
+  off_t offset,
+  unsigned int length,
+  unsigned int record)
+{
+  char entry[ENTRY_WIDTH + 1];
+  snprintf (entry, sizeof (entry), "%-36.36s %020llu %010u %010u\n",
+            uuid.c_str (), (unsigned long long) offset, length, record);
+  return std::string (entry, ENTRY_WIDTH);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void parseEntry (
+  const char* entry,
+  std::string& uuid,
+  UUIDIndex::Version& version)
+{
+  uuid.assign (entry, UUID_WIDTH);
+  if (uuid[0] == ' ')
+    uuid = "";
+
+  version.offset = (off_t)        strtoull (entry + UUID_WIDTH + 1,  nullptr, 10);
+  version.length = (unsigned int) strtoul  (entry + UUID_WIDTH + 22, nullptr, 10);
+  version.record = (unsigned int) strtoul  (entry + UUID_WIDTH + 33, nullptr, 10);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+UUIDIndex::UUIDIndex (const std::string& data, const std::string& index)
+: _data (data)
+, _index (index)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+UUIDIndex::~UUIDIndex ()
+{
+  if (_fd != -1)
+    ::close (_fd);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Loads the index, which must cover exactly the given number of records, and
+// all of the data.  If it is already loaded, only the entries for records
+// added since are read.  Returns false if it is missing or stale, in which
+// case the caller rebuilds it.
+bool UUIDIndex::load (unsigned int records)
+{
+  // The data may have been replaced since it was last read.
+  if (_fd != -1)
+  {
+    ::close (_fd);
+    _fd = -1;
+  }
+
+  struct stat st;
+  if (::stat (_data.c_str (), &st))
+  {
+    clear ();
+    return false;
+  }
+
+  if (! _loaded || records < _records)
+    clear ();
+
+  if (records > _records)
+  {
+    int fd = ::open (_index.c_str (), O_RDONLY);
+    if (fd == -1)
+    {
+      clear ();
+      return false;
+    }
+
+    struct stat index;
+    std::string entries ((records - _records) * ENTRY_WIDTH, '\0');
+    bool complete = ! ::fstat (fd, &index)                                  &&
+                    index.st_size == (off_t) records * ENTRY_WIDTH          &&
+                    ::pread (fd, &entries[0], entries.length (),
+                             (off_t) _records * ENTRY_WIDTH) == (ssize_t) entries.length ();
+    ::close (fd);
+
+    // Each entry must follow on from the one before.
+    std::string uuid;
+    Version version {0, 0, 0};
+    for (std::string::size_type i = 0; complete && i < entries.length (); i += ENTRY_WIDTH)
+    {
+      parseEntry (entries.data () + i, uuid, version);
+      if (version.record != _records ||
+          version.offset != _size)
+      {
+        complete = false;
+        break;
+      }
+
+      if (uuid != "")
+        _versions[uuid].push_back (version);
+
+      _size += version.length;
+      ++_records;
+    }
+
+    if (! complete)
+    {
+      clear ();
+      return false;
+    }
+  }
+
+  if (_size != st.st_size)
+  {
+    clear ();
+    return false;
+  }
+
+  _loaded = true;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Replaces the index with one covering all of the given data, which holds
+// records without their newline terminators.  If a UUID cannot be indexed, the
+// versions are still kept in memory, but no index is written.
+void UUIDIndex::rebuild (const std::vector <std::string>& data)
+{
+  clear ();
+
+  std::string entries;
+  std::string unindexable;
+  off_t offset = 0;
+  unsigned int record = 0;
+  for (auto& line : data)
+  {
+    std::string uuid;
+    if (line[0] == '{')
+      uuid = Task (line).get ("uuid");
+
+    Version version {offset, (unsigned int) line.length () + 1, record};
+    if (! indexable (uuid))
+      unindexable = uuid;
+
+    entries += composeEntry (uuid, version.offset, version.length, version.record);
+    if (uuid != "")
+      _versions[uuid].push_back (version);
+
+    offset += version.length;
+    ++record;
+  }
+
+  if (unindexable != "")
+  {
+    ::unlink (_index.c_str ());
+    throw format ("Could not index UUID '{1}' in '{2}'.", unindexable, _index);
+  }
+
+  std::string temp = _index + ".tmp";
+  int fd = ::open (temp.c_str (), O_WRONLY | O_TRUNC | O_CREAT, 0600);
+  if (fd == -1)
+    throw format ("Could not open '{1}': {2}", temp, strerror (errno));
+
+  auto status = ::write (fd, entries.data (), entries.length ());
+  int error = errno;
+  ::close (fd);
+
+  if (status != (ssize_t) entries.length ())
+  {
+    ::unlink (temp.c_str ());
+    throw format ("Could not write '{1}': {2}", temp, strerror (error));
+  }
+
+  if (::rename (temp.c_str (), _index.c_str ()))
+  {
+    error = errno;
+    ::unlink (temp.c_str ());
+    throw format ("Could not rename '{1}': {2}", temp, strerror (error));
+  }
+
+  _records = record;
+  _size    = offset;
+  _loaded  = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Indexes records just appended to the data at the given offset, where the
+// first of them is the given record number, and each record has the UUID at
+// the same position, blank for a sync key.  Nothing is added unless the index
+// already covers all prior data, because a stale index is rebuilt anyway.  A
+// UUID that cannot be indexed removes the index instead.
+void UUIDIndex::add (
+  const std::vector <std::string>& records,
+  const std::vector <std::string>& uuids,
+  off_t offset,
+  unsigned int record) const
+{
+  for (auto& uuid : uuids)
+    if (! indexable (uuid))
+    {
+      ::unlink (_index.c_str ());
+      throw format ("Could not index UUID '{1}' in '{2}'.", uuid, _index);
+    }
+
+  int fd = ::open (_index.c_str (), O_RDWR | O_APPEND | (record ? 0 : O_CREAT), 0600);
+  if (fd == -1)
+    return;
+
+  struct stat st;
+  if (::fstat (fd, &st) ||
+      st.st_size != (off_t) record * ENTRY_WIDTH)
+  {
+    ::close (fd);
+    return;
+  }
+
+  if (record)
+  {
+    char last[ENTRY_WIDTH];
+    std::string uuid;
+    Version version {0, 0, 0};
+    if (::pread (fd, last, ENTRY_WIDTH, st.st_size - ENTRY_WIDTH) != ENTRY_WIDTH)
+    {
+      ::close (fd);
+      return;
+    }
+
+    parseEntry (last, uuid, version);
+    if (version.record + 1 != record ||
+        version.offset + version.length != offset)
+    {
+      ::close (fd);
+      return;
+    }
+  }
+
+  std::string entries;
+  for (unsigned int i = 0; i < records.size (); ++i)
+  {
+    entries += composeEntry (uuids[i], offset, records[i].length (), record);
+    offset += records[i].length ();
+    ++record;
+  }
+
+  auto status = ::write (fd, entries.data (), entries.length ());
+  int error = errno;
+  ::close (fd);
+
+  if (status != (ssize_t) entries.length ())
+    throw format ("Could not write '{1}': {2}", _index, strerror (error));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void UUIDIndex::clear ()
+{
+  _versions.clear ();
+  _records = 0;
+  _size    = 0;
+  _loaded  = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The versions of a task, oldest first.
+const std::vector <UUIDIndex::Version>& UUIDIndex::versions (const std::string& uuid) const
+{
+  static const std::vector <Version> none;
+
+  auto i = _versions.find (uuid);
+  if (i == _versions.end ())
+    return none;
+
+  return i->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reads one record, without its newline.  A record that does not match the
+// index means the data was changed behind the index, which is then removed,
+// to be rebuilt by the next sync.
+std::string UUIDIndex::read (const Version& version) const
+{
+  if (_fd == -1)
+  {
+    _fd = ::open (_data.c_str (), O_RDONLY);
+    if (_fd == -1)
+      throw format ("Could not open '{1}': {2}", _data, strerror (errno));
+  }
+
+  std::string record (version.length, '\0');
+  auto status = ::pread (_fd, &record[0], version.length, version.offset);
+  if (status != (ssize_t) version.length ||
+      record[0] != '{'                   ||
+      record[version.length - 1] != '\n')
+  {
+    ::unlink (_index.c_str ());
+    _loaded = false;
+    throw format ("The index '{1}' does not match the data, and will be rebuilt.", _index);
+  }
+
+  record.resize (version.length - 1);
+  return record;
+}
+
+////////////////////////////////////////////////////////////////////////////////
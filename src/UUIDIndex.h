@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef INCLUDED_UUIDINDEX
+#define INCLUDED_UUIDINDEX
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sys/types.h>
+
+// An index of every record in a user's tx.data, giving the task UUID, byte
+// offset, length and record number of each, so that the versions of a task
+// are read directly.  Sync key records are indexed with a blank UUID, which
+// lets the index be checked for complete coverage of the data.  Once loaded,
+// the index is kept current by reading only the entries added since.
+class UUIDIndex
+{
+public:
+  struct Version
+  {
+    off_t        offset;
+    unsigned int length;
+    unsigned int record;
+  };
+
+  UUIDIndex (const std::string&, const std::string&);
+  ~UUIDIndex ();
+  bool load (unsigned int);
+  void rebuild (const std::vector <std::string>&);
+  void add (const std::vector <std::string>&, const std::vector <std::string>&, off_t, unsigned int) const;
+  const std::vector <Version>& versions (const std::string&) const;
+  std::string read (const Version&) const;
+
+private:
+  void clear ();
+
+private:
+  std::string                                    _data;
+  std::string                                    _index;
+  std::map <std::string, std::vector <Version>>  _versions {};
+  unsigned int                                   _records  {0};
+  off_t                                          _size     {0};
+  mutable bool                                   _loaded   {false};
+  mutable int                                    _fd       {-1};
+};
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
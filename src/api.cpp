@@ -152,6 +152,24 @@ bool taskd_sendMessage (
   const std::string& to,
   const Msg& out,
   Msg& in)
+{
+  std::vector <Msg> responses;
+  if (! taskd_sendMessages (config, to, {out}, responses))
+    return false;
+
+  in = responses[0];
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sends the messages in turn over one connection, each after the response to
+// the previous one is received.  More than one message requires a server with
+// keep-alive enabled.
+bool taskd_sendMessages (
+  Config& config,
+  const std::string& to,
+  const std::vector <Msg>& out,
+  std::vector <Msg>& in)
 {
   auto destination = config.get (to);
   auto colon = destination.rfind (':');
@@ -178,13 +196,19 @@ bool taskd_sendMessage (
     client.ciphers (ciphers);
     client.init (ca, certificate, key);
     client.connect (server, port);
-    client.send (out.serialize () + "\n");
 
-    std::string response;
-    client.recv (response);
-    client.bye ();
+    for (auto& message : out)
+    {
+      client.send (message.serialize () + "\n");
+
+      std::string response;
+      client.recv (response);
 
-    in.parse (response);
+      in.push_back (Msg ());
+      in.back ().parse (response);
+    }
+
+    client.bye ();
 
     // Indicate message sent.
     return true;
@@ -299,31 +323,3 @@ std::string taskd_error (const int code)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void taskd_staticInitialize ()
-{
-  // List is corrected as of 2.3.0.
-  // Note: annotation_* fields are missing, and are assumed to be 'string'
-  // Note: UDA fields are missing, and are assumed to be 'string'
-
-  Task::attributes["depends"]     = "string";
-  Task::attributes["description"] = "string";
-  Task::attributes["due"]         = "date";
-  Task::attributes["end"]         = "date";
-  Task::attributes["entry"]       = "date";
-  Task::attributes["imask"]       = "numeric";
-  Task::attributes["mask"]        = "string";
-  Task::attributes["modified"]    = "date";
-  Task::attributes["parent"]      = "string";
-  Task::attributes["priority"]    = "string";
-  Task::attributes["project"]     = "string";
-  Task::attributes["recur"]       = "duration";
-  Task::attributes["scheduled"]   = "date";
-  Task::attributes["start"]       = "date";
-  Task::attributes["status"]      = "string";
-  Task::attributes["tags"]        = "string";
-  Task::attributes["until"]       = "date";
-  Task::attributes["uuid"]        = "string";
-  Task::attributes["wait"]        = "date";
-}
-
-////////////////////////////////////////////////////////////////////////////////
@@ -45,18 +45,29 @@ void command_api (Database& db, const std::vector <std::string>& args)
 
   db._config->set ("server", args[1]);
 
+  // With keep-alive, all files are sent over one connection.
+  bool keepalive = db._config->getBoolean ("keepalive");
+  std::vector <Msg> requests;
+
   for (unsigned int i = 2; i < args.size (); ++i)
   {
     // Read file.
     File file (args[i]);
     std::string contents;
     file.read (contents);
-    std::cout << ">>> " << args[i] << '\n';
 
     Msg request;
     request.parse (contents);
     request.set ("time", Datetime ().toISO ());
 
+    if (keepalive)
+    {
+      requests.push_back (request);
+      continue;
+    }
+
+    std::cout << ">>> " << args[i] << '\n';
+
     Msg response;
     if (! taskd_sendMessage (*db._config, "server", request, response))
       throw std::string ("ERROR: Taskserver not responding.");
@@ -64,6 +75,18 @@ void command_api (Database& db, const std::vector <std::string>& args)
     std::cout << "<<<\n"
               << response.serialize ();
   }
+
+  if (keepalive)
+  {
+    std::vector <Msg> responses;
+    if (! taskd_sendMessages (*db._config, "server", requests, responses))
+      throw std::string ("ERROR: Taskserver not responding.");
+
+    for (unsigned int i = 0; i < responses.size (); ++i)
+      std::cout << ">>> " << args[i + 2] << '\n'
+                << "<<<\n"
+                << responses[i].serialize ();
+  }
 #else
   throw std::string ("ERROR: API feature not enabled.");
 #endif
@@ -29,6 +29,12 @@
 #include <algorithm>
 #include <sstream>
 #include <cstring>
+#include <mutex>
+#include <atomic>
+#include <new>
+#include <list>
+#include <memory>
+#include <unordered_map>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <unistd.h>
@@ -38,6 +44,13 @@
 #include <shared.h>
 #include <Datetime.h>
 #include <Database.h>
+#include <Arena.h>
+#include <MergeSet.h>
+#include <LockTable.h>
+#include <SyncIndex.h>
+#include <UUIDIndex.h>
+#include <Snapshot.h>
+#include <TxData.h>
 #include <format.h>
 #include <Log.h>
 #include <Color.h>
@@ -54,28 +67,142 @@ extern bool _sigusr1;
 extern bool _sigusr2;
 static Config _overrides;
 
+// Identifies the request being handled by this thread, in the log.
+static thread_local long _txn_id {0};
+
+////////////////////////////////////////////////////////////////////////////////
+// Parses records into tasks on first use, so that during one request, each
+// record is parsed at most once, however often it is consulted.  The tasks are
+// placed in the request arena.
+class RecordCache
+{
+public:
+  RecordCache (const std::vector <std::string>&, Arena&);
+  RecordCache (const RecordCache&) = delete;
+  RecordCache& operator= (const RecordCache&) = delete;
+  ~RecordCache ();
+  const Task& get (unsigned int);
+
+private:
+  const std::vector <std::string>&                _records;
+  Arena&                                          _arena;
+  std::vector <Task*, ArenaAllocator <Task*>>     _tasks;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+RecordCache::RecordCache (const std::vector <std::string>& records, Arena& arena)
+: _records (records)
+, _arena (arena)
+, _tasks (records.size (), nullptr, ArenaAllocator <Task*> (arena))
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The arena releases the memory, but the tasks must still be destroyed.
+RecordCache::~RecordCache ()
+{
+  for (auto& task : _tasks)
+    if (task)
+      task->~Task ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const Task& RecordCache::get (unsigned int index)
+{
+  if (! _tasks[index])
+  {
+    void* memory = _arena.allocate (sizeof (Task), alignof (Task));
+    _tasks[index] = new (memory) Task (_records[index]);
+  }
+
+  return *_tasks[index];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The UUID indexes of recently synced users stay loaded between syncs, so that
+// a sync reads only the index entries added since the last one, rather than
+// the whole index.  The least recently used index is dropped when there are
+// more than the capacity.  An index is only used while its user is locked.
+class IndexCache
+{
+public:
+  void capacity (int);
+  std::shared_ptr <UUIDIndex> get (const std::string&, const std::string&, const std::string&);
+
+private:
+  typedef std::list <std::pair <std::string, std::shared_ptr <UUIDIndex>>> Entries;
+
+  std::mutex                                           _mutex    {};
+  unsigned int                                         _capacity {100};
+  Entries                                              _entries  {};
+  std::unordered_map <std::string, Entries::iterator>  _find     {};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+void IndexCache::capacity (int value)
+{
+  std::lock_guard <std::mutex> lock (_mutex);
+  _capacity = value > 0 ? value : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The index named, which is created for data and index files if not cached.
+std::shared_ptr <UUIDIndex> IndexCache::get (
+  const std::string& name,
+  const std::string& data,
+  const std::string& index)
+{
+  std::lock_guard <std::mutex> lock (_mutex);
+
+  auto found = _find.find (name);
+  if (found != _find.end ())
+  {
+    _entries.splice (_entries.begin (), _entries, found->second);
+    return found->second->second;
+  }
+
+  std::shared_ptr <UUIDIndex> result (new UUIDIndex (data, index));
+  if (_capacity)
+  {
+    _entries.emplace_front (name, result);
+    _find[name] = _entries.begin ();
+
+    while (_entries.size () > _capacity)
+    {
+      _find.erase (_entries.back ().first);
+      _entries.pop_back ();
+    }
+  }
+
+  return result;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 class Daemon : public Server
 {
 public:
   Daemon (Config&);
   void handler (const std::string& input, std::string& output);
+  void reload ();
+  void reject (std::string&, int);
+  void setIndexCache (int);
 
 private:
   void handle_statistics (const Msg&, Msg&);
-  void handle_sync       (const Msg&, Msg&);
+  void handle_sync       (const Msg&, const std::string&, std::string::size_type, Msg&);
 
 private:
-  void parse_payload (const std::string&, std::vector <std::string>&, std::string&) const;
-  void load_server_data (const std::string&, const std::string&, std::vector <std::string>&) const;
-  void append_server_data (const std::string&, const std::string&, const std::vector <std::string>&) const;
+  void parse_payload (const std::string&, std::string::size_type, std::vector <std::string>&, std::string&) const;
+  std::string user_file (const std::string&, const std::string&, const std::string&) const;
+  void load_server_data (const std::string&, const std::string&, off_t, std::vector <std::string>&) const;
+  void append_server_data (const std::string&, const std::string&, unsigned int, const std::vector <std::string>&, const std::vector <std::string>&) const;
+  void discard_cache (const std::string&, const std::string&) const;
   unsigned int find_branch_point (const std::vector <std::string>&, const std::string&) const;
-  void extract_subset (const std::vector <std::string>&, const unsigned int, std::vector <Task>&) const;
-  bool contains (const std::vector <Task>&, const std::string&) const;
-  std::string generate_payload (const std::vector <Task>&, const std::vector <std::string>&, const std::string&) const;
-  unsigned int find_common_ancestor (const std::vector <std::string>&, unsigned int, const std::string&) const;
-  void get_client_mods (std::vector <Task>&, const std::vector <std::string>&, const std::string&) const;
-  void get_server_mods (std::vector <Task>&, const std::vector <std::string>&, const std::string&, unsigned int) const;
+  void extract_subset (const std::vector <std::string>&, RecordCache&, bool, std::vector <std::string>&, MergeSet&, Arena&) const;
+  std::string generate_payload (const std::vector <std::string>&, const std::vector <std::string>&, const std::string&) const;
+  unsigned int find_common_ancestor (const std::vector <UUIDIndex::Version>&, unsigned int, const std::string&) const;
+  void get_client_mods (std::vector <Task>&, RecordCache&, const std::vector <unsigned int>&) const;
+  void get_server_mods (std::vector <Task>&, const UUIDIndex&, const std::vector <UUIDIndex::Version>&, unsigned int, RecordCache&, unsigned int) const;
   void merge_sort (const std::vector <Task>&, const std::vector <Task>&, Task&) const;
   time_t last_modification (const Task&) const;
   void patch (Task&, const Task&, const Task&) const;
@@ -86,13 +213,16 @@ public:
 
 private:
   Config& _config;
-  Datetime _start    {Datetime ()};
-  long _txn_count    {0};
-  long _error_count  {0};
-  double _busy       {0.0};
-  double _max_time   {0.0};
-  long _bytes_in     {0};
-  long _bytes_out    {0};
+  Datetime _start                 {Datetime ()};
+  std::atomic <long> _txn_count   {0};
+  std::atomic <long> _error_count {0};
+  std::atomic <long> _bytes_in    {0};
+  std::atomic <long> _bytes_out   {0};
+  std::mutex _timing_mutex        {};
+  double _busy                    {0.0};
+  double _max_time                {0.0};
+  LockTable _locks                {};
+  IndexCache _indexes             {};
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -105,7 +235,7 @@ Daemon::Daemon (Config& settings)
 ////////////////////////////////////////////////////////////////////////////////
 void Daemon::handler (const std::string& input, std::string& output)
 {
-  ++_txn_count;
+  _txn_id = ++_txn_count;
 
   try
   {
@@ -131,21 +261,6 @@ void Daemon::handler (const std::string& input, std::string& output)
          ! input[3]))
       throw 401;
 
-    // A trapped SIGUSR1 results in a config reload.  Original command line
-    // overrides are preserved.
-    if (_sigusr1)
-    {
-      if (_log)
-        _log->write (format ("[{1}] SIGUSR1 triggered reload of {2}", _txn_count, _config._original_file._data));
-
-      _config.load (_config._original_file._data);
-
-      for (auto& i : _overrides)
-        _config[i.first] = i.second;
-
-      _sigusr1 = false;
-    }
-
     unsigned int request_limit = (unsigned) _config.getInteger ("request.limit");
     if (request_limit > 0 &&
         input.length () >= request_limit)
@@ -154,19 +269,24 @@ void Daemon::handler (const std::string& input, std::string& output)
     Timer timer;
     timer.start ();
 
-    // Request-specific processing here.
+    // Request-specific processing here.  Only the header is parsed into the
+    // message, and the payload, which may be large, is read where it lies.
     Msg in;
-    in.parse (input);
+    auto body = input.find ("\n\n");
+    if (body == std::string::npos)
+      in.parse (input);
+    else
+      in.parse (input.substr (0, body += 2));
     Msg out;
 
     // Handle or reject all message types.
     auto type = in.get ("type");
          if (type == "statistics") handle_statistics (in, out);
-    else if (type == "sync")       handle_sync       (in, out);
+    else if (type == "sync")       handle_sync       (in, input, body, out);
     else
     {
       if (_log)
-        _log->write (format ("[{1}] ERROR: Unrecognized message type '{2}'", _txn_count, type));
+        _log->write (format ("[{1}] ERROR: Unrecognized message type '{2}'", _txn_id, type));
 
       throw 500;
     }
@@ -176,6 +296,8 @@ void Daemon::handler (const std::string& input, std::string& output)
     // Record response time.
     timer.stop ();
     auto total = timer.total_s ();
+
+    std::lock_guard <std::mutex> lock (_timing_mutex);
     _busy += total;
 
     // Record high-water mark.
@@ -193,7 +315,7 @@ void Daemon::handler (const std::string& input, std::string& output)
     output = err.serialize ();
 
     if (_log)
-      _log->write (format ("[{1}] ERROR: {2} {3}", _txn_count, e, taskd_error (e)));
+      _log->write (format ("[{1}] ERROR: {2} {3}", _txn_id, e, taskd_error (e)));
   }
 
   // Handlers can throw a string, for a 500 code with specific text.
@@ -206,20 +328,59 @@ void Daemon::handler (const std::string& input, std::string& output)
     output = err.serialize ();
 
     if (_log)
-      _log->write (format ("[{1}] {2}", _txn_count, e));
+      _log->write (format ("[{1}] {2}", _txn_id, e));
   }
 
   // Mystery errors.
   catch (...)
   {
     if (_log)
-      _log->write (format ("[{1}] Unknown error", _txn_count));
+      _log->write (format ("[{1}] Unknown error", _txn_id));
   }
 
   _bytes_in  += input.length ();
   _bytes_out += output.length ();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// An overloaded server answers with 420, and a hint of when to retry, instead of
+// handling the request.
+void Daemon::reject (std::string& output, int retry)
+{
+  Msg err;
+  err.set ("code", 420);
+  err.set ("status", taskd_error (420));
+  err.set ("retry-after", retry);
+  output = err.serialize ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The number of users whose UUID indexes are kept loaded.
+void Daemon::setIndexCache (int users)
+{
+  _indexes.capacity (users);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// A trapped SIGUSR1 results in a config reload.  Original command line
+// overrides are preserved.
+void Daemon::reload ()
+{
+  if (_log)
+    _log->write (format ("SIGUSR1 triggered reload of {1}", _config._original_file._data));
+
+  _config.load (_config._original_file._data);
+
+  for (auto& i : _overrides)
+    _config[i.first] = i.second;
+
+  setLimit (_config.getInteger ("request.limit"));
+
+  // Cached authentication may no longer hold under the new configuration,
+  // and a reload is also a way to clear it by hand.
+  _db.invalidate ();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Statistics request from dev.
 void Daemon::handle_statistics (const Msg& in, Msg& out)
@@ -232,7 +393,7 @@ void Daemon::handle_statistics (const Msg& in, Msg& out)
 
   if (_log)
     _log->write (format ("[{1}] 'statistics' from {2}:{3}",
-                         _txn_count,
+                         _txn_id,
                          _client_address,
                          _client_port));
 
@@ -243,20 +404,48 @@ void Daemon::handle_statistics (const Msg& in, Msg& out)
   get_totals (total_orgs, total_users, total_bytes);
 
   // Stats about the server.
+  double busy;
+  double max_time;
+  {
+    std::lock_guard <std::mutex> lock (_timing_mutex);
+    busy     = _busy;
+    max_time = _max_time;
+  }
+
+  long lock_count;
+  long lock_contended;
+  double lock_wait;
+  double lock_max_wait;
+  _locks.statistics (lock_count, lock_contended, lock_wait, lock_max_wait);
+
+  double average_lock_wait = 0.0;
+  if (lock_count)
+    average_lock_wait = lock_wait / lock_count;
+
+  long handshakes = _handshakes;
+  long resumed    = _resumed;
+  double resumption_rate = 0.0;
+  if (handshakes)
+    resumption_rate = (double) resumed / handshakes;
+
+  long timeouts = _timeouts;
+  long shed     = _shed;
+
+  long txn_count = _txn_count;
   time_t uptime = Datetime () - _start;
   double idle = 0.0;
   if (uptime != 0)
-    idle = 1.0 - (_busy / (double) uptime);
+    idle = 1.0 - (busy / (double) uptime);
 
   int average_req          = 0;
   int average_resp         = 0;
   double average_resp_time = 0.0;
   double tps               = 0.0;
-  if (_txn_count)
+  if (txn_count)
   {
-    average_req       = _bytes_in  / _txn_count;
-    average_resp      = _bytes_out / _txn_count;
-    average_resp_time = _busy      / _txn_count;
+    average_req       = _bytes_in  / txn_count;
+    average_resp      = _bytes_out / txn_count;
+    average_resp_time = busy       / txn_count;
 
     // Only calculate tps if average_resp_time is non-trivial.
     if (average_resp_time > 0.000001)
@@ -264,16 +453,25 @@ void Daemon::handle_statistics (const Msg& in, Msg& out)
   }
 
   out.set ("uptime",                 (int) uptime);
-  out.set ("transactions",           (int) _txn_count);
-  out.set ("errors",                 (int) _error_count);
+  out.set ("transactions",           (int) txn_count);
+  out.set ("errors",                 (int) _error_count.load ());
   out.set ("idle",                         idle);
-  out.set ("total bytes in",         (int) _bytes_in);
-  out.set ("total bytes out",        (int) _bytes_out);
+  out.set ("total bytes in",         (int) _bytes_in.load ());
+  out.set ("total bytes out",        (int) _bytes_out.load ());
   out.set ("average request bytes",  (int) average_req);
   out.set ("average response bytes", (int) average_resp);
   out.set ("average response time",        average_resp_time);
-  out.set ("maximum response time",        _max_time);
+  out.set ("maximum response time",        max_time);
   out.set ("tps",                          tps);
+  out.set ("locks",                  (int) lock_count);
+  out.set ("contended locks",        (int) lock_contended);
+  out.set ("average lock wait time",       average_lock_wait);
+  out.set ("maximum lock wait time",       lock_max_wait);
+  out.set ("tls handshakes",         (int) handshakes);
+  out.set ("tls resumed sessions",   (int) resumed);
+  out.set ("tls resumption rate",          resumption_rate);
+  out.set ("timeouts",               (int) timeouts);
+  out.set ("shed requests",          (int) shed);
   out.set ("organizations",          (int) total_orgs);
   out.set ("users",                  (int) total_users);
   out.set ("user data",              (int) total_bytes);
@@ -283,8 +481,12 @@ void Daemon::handle_statistics (const Msg& in, Msg& out)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Sync request.
-void Daemon::handle_sync (const Msg& in, Msg& out)
+// Sync request.  The payload is the input from offset body onwards.
+void Daemon::handle_sync (
+  const Msg& in,
+  const std::string& input,
+  std::string::size_type body,
+  Msg& out)
 {
   if (! _db.authenticate (in, out))
     return;
@@ -300,7 +502,7 @@ void Daemon::handle_sync (const Msg& in, Msg& out)
 
   if (_log)
     _log->write (format ("[{1}] 'sync{2}' from '{3}/{4}' using '{5}' at {6}:{7}",
-                         _txn_count,
+                         _txn_id,
                          (subtype == "init" ? "+init" : ""),
                          org,
                          user,
@@ -312,67 +514,190 @@ void Daemon::handle_sync (const Msg& in, Msg& out)
   if (_db.redirect (org, out))
     return;
 
+  // The many small objects that live only as long as this request, such as
+  // parsed tasks and hashed UUIDs, are allocated together, and freed at once.
+  Arena arena;
+
   // Separate payload into client_data and sync_key.
   std::vector <std::string> client_data;               // Incoming client data.
   std::string sync_key;                                // Incoming client key.
-  parse_payload (in.getPayload (), client_data, sync_key);
+  parse_payload (input, body, client_data, sync_key);
+
+  // Syncs for the same user are serialized, from loading through appending
+  // their data, while other users proceed concurrently.
+  ScopedLock lock (_locks, org + '/' + password);
+
+  std::vector <std::string> server_data;               // Data from branch point.
+  std::vector <std::string> history;                   // All data, when needed.
+  unsigned int branch_point = 0;
+  unsigned int records = 0;                            // Records in all data.
+  unsigned int first_record = 0;                       // Of server_data.
+
+  // A first sync needs only the latest version of each task, which is kept in
+  // a snapshot, brought up to date with the data appended since it was saved.
+  if (sync_key == "")
+  {
+    Snapshot snapshot (user_file (org, password, "tx.data"),
+                       user_file (org, password, "tx.latest"));
+    snapshot.load ();
+
+    std::vector <std::string> appended;
+    load_server_data (org, password, snapshot.offset (), appended);
+    if (appended.size ())
+    {
+      snapshot.apply (appended);
+      try
+      {
+        snapshot.save ();
+      }
+
+      catch (const std::string& e)
+      {
+        discard_cache (user_file (org, password, "tx.latest"), e);
+      }
+    }
+
+    snapshot.latest (server_data);
+    records = snapshot.records ();
+    first_record = records;
+    _log->write (format ("[{1}] Snapshot of {2} tasks", _txn_id, server_data.size ()));
+  }
 
-  // Load all user data.
-  std::vector <std::string> server_data;               // Data loaded on server.
-  load_server_data (org, password, server_data);
+  // Otherwise find the branch point in the index, and load only the user data
+  // that follows it.  If the key is not indexed, all user data is loaded and
+  // scanned instead, and the index rebuilt.
+  else
+  {
+    SyncIndex index (user_file (org, password, "tx.data"),
+                     user_file (org, password, "tx.index"));
+    off_t offset = 0;
+    if (index.find (sync_key, offset, branch_point))
+    {
+      _log->write (format ("[{1}] Branch point: {2} --> {3} (indexed)", _txn_id, sync_key, branch_point));
+      load_server_data (org, password, offset, server_data);
+    }
+    else
+    {
+      load_server_data (org, password, 0, history);
+      branch_point = find_branch_point (history, sync_key);
+      try
+      {
+        index.rebuild (history);
+      }
+
+      catch (const std::string& e)
+      {
+        discard_cache (user_file (org, password, "tx.index"), e);
+      }
+
+      server_data.assign (history.begin () + branch_point, history.end ());
+    }
+
+    records = branch_point + server_data.size ();
+    first_record = branch_point;
+  }
 
   std::vector <std::string> new_server_data;           // New tasks for tx.data.
+  std::vector <std::string> new_server_uuids;          // Their UUIDs.
   std::vector <std::string> new_client_data;           // New tasks for client.
 
-  // Find branch point and extract subset.
-  unsigned int branch_point = find_branch_point (server_data, sync_key);
-  std::vector <Task> server_subset;
-  extract_subset (server_data, branch_point, server_subset);
+  // Records are parsed once, on first use.
+  RecordCache server_cache (server_data, arena);
+  RecordCache client_cache (client_data, arena);
+
+  // Extract subset, and hash its UUIDs.  The subset is sent back verbatim.
+  // Clients that ask for only the latest versions are spared the superseded
+  // ones.
+  bool latest = in.get ("versions") == "latest";
+  std::vector <std::string> server_subset;
+  MergeSet merges (arena);
+  extract_subset (server_data, server_cache, latest, server_subset, merges, arena);
+
+  auto uuid_index = _indexes.get (org + '/' + password,
+                                  user_file (org, password, "tx.data"),
+                                  user_file (org, password, "tx.uuids"));
+  bool indexed = false;
+
+  // Where each UUID occurs in the client data is hashed once, as are the
+  // subset UUIDs, so the merge loop is linear in the number of tasks.
+  for (unsigned int i = 0; i < client_data.size (); ++i)
+    if (client_data[i][0] == '{')
+      merges.client (client_cache.get (i).get ("uuid"), i);
 
-  // Maintain a list of already-merged task UUIDs.
-  std::vector <std::string> already_seen;
   int store_count = 0;
   int merge_count = 0;
 
   // For each incoming task...
-  for (auto& client_task : client_data)
+  for (unsigned int i = 0; i < client_data.size (); ++i)
   {
+    auto& client_task = client_data[i];
+
     // Validate task.
-    Task task (client_task);
+    Task task (client_cache.get (i));
     std::string uuid = task.get ("uuid");
     task.validate ();
 
     // If task is in subset
-    if (contains (server_subset, uuid))
+    if (merges.contains (uuid))
     {
       // Merging a task causes a complete scan, and that picks up all mods to
       // that same task.  Therefore, there is no need to re-process a UUID.
-      if (std::find (already_seen.begin (), already_seen.end (), uuid) != already_seen.end ())
+      if (! merges.first (uuid))
         continue;
 
-      already_seen.push_back (uuid);
+      // The versions of the task, including the common ancestor that may
+      // precede the branch point, are read through the UUID index.  If that
+      // is missing or stale, it is rebuilt from all user data.
+      if (! indexed)
+      {
+        if (! uuid_index->load (records))
+        {
+          _log->write (format ("[{1}] Rebuilding UUID index", _txn_id));
+          if (first_record && history.empty ())
+            load_server_data (org, password, 0, history);
+
+          // The versions are kept in memory even if the index is not saved.
+          try
+          {
+            uuid_index->rebuild (first_record ? history : server_data);
+          }
+
+          catch (const std::string& e)
+          {
+            discard_cache (user_file (org, password, "tx.uuids"), e);
+          }
+        }
+
+        indexed = true;
+      }
+
+      auto& versions = uuid_index->versions (uuid);
 
       // Find common ancestor, prior to branch point
-      unsigned int common_ancestor = find_common_ancestor (server_data,
+      unsigned int common_ancestor = find_common_ancestor (versions,
                                                            branch_point,
                                                            uuid);
 
       // List the client-side modifications.
       std::vector <Task> client_mods;
-      get_client_mods (client_mods, client_data, uuid);
+      get_client_mods (client_mods, client_cache, merges.records (uuid));
 
       // List the server-side modifications.
       std::vector <Task> server_mods;
-      get_server_mods (server_mods, server_data, uuid, common_ancestor);
+      get_server_mods (server_mods, *uuid_index, versions, common_ancestor,
+                       server_cache, first_record);
 
       // Merge sort between client_mods and server_mods, patching ancestor.
-      Task combined (server_data[common_ancestor]);
+      Task combined (uuid_index->read (versions[common_ancestor]));
       merge_sort (client_mods, server_mods, combined);
-      std::string combined_JSON = combined.composeJSON ();
+      std::string combined_JSON;
+      combined.composeJSON (combined_JSON);
 
       // Append combined task to client and server data, if not already there.
-      new_server_data.push_back (combined_JSON + "\n");
       new_client_data.push_back (combined_JSON);
+      combined_JSON += '\n';
+      new_server_data.push_back (std::move (combined_JSON));
+      new_server_uuids.push_back (uuid);
       ++merge_count;
     }
     else
@@ -380,12 +705,13 @@ void Daemon::handle_sync (const Msg& in, Msg& out)
       // Task not in subset, therefore can be stored unmodified.  Does not get
       // returned to client.
       new_server_data.push_back (client_task + "\n");
+      new_server_uuids.push_back (uuid);
       ++store_count;
     }
   }
 
   _log->write (format ("[{1}] Stored {2} tasks, merged {3} tasks",
-                       _txn_count,
+                       _txn_id,
                        store_count,
                        merge_count));
 
@@ -396,10 +722,11 @@ void Daemon::handle_sync (const Msg& in, Msg& out)
   {
     new_sync_key = uuid ();
     new_server_data.push_back (new_sync_key + "\n");
-    _log->write (format ("[{1}] New sync key '{2}'", _txn_count, new_sync_key));
+    new_server_uuids.push_back ("");
+    _log->write (format ("[{1}] New sync key '{2}'", _txn_id, new_sync_key));
 
     // Append new_server_data to file.
-    append_server_data (org, password, new_server_data);
+    append_server_data (org, password, records, new_server_data, new_server_uuids);
   }
   else
   {
@@ -411,7 +738,7 @@ void Daemon::handle_sync (const Msg& in, Msg& out)
         break;
       }
 
-    _log->write (format ("[{1}] Sync key '{2}' still valid", _txn_count, new_sync_key));
+    _log->write (format ("[{1}] Sync key '{2}' still valid", _txn_id, new_sync_key));
   }
 
   // If there is outgoing data, generate payload + key.
@@ -431,6 +758,13 @@ void Daemon::handle_sync (const Msg& in, Msg& out)
   }
 
   out.setPayload (payload);
+  if (latest)
+    out.set ("versions", "latest");
+
+  _log->write (format ("[{1}] Arena {2} allocations, {3} bytes",
+                       _txn_id,
+                       arena.allocations (),
+                       arena.size ()));
 
   // If there are changes, respond with 200, otherwise 201.
   if (server_subset.size ()   ||
@@ -442,7 +776,7 @@ void Daemon::handle_sync (const Msg& in, Msg& out)
   }
   else
   {
-    _log->write (format ("[{1}] No change", _txn_count));
+    _log->write (format ("[{1}] No change", _txn_id));
     out.set ("code",   201);
     out.set ("status", taskd_error (201));
   }
@@ -451,84 +785,115 @@ void Daemon::handle_sync (const Msg& in, Msg& out)
 ////////////////////////////////////////////////////////////////////////////////
 void Daemon::parse_payload (
   const std::string& payload,
+  std::string::size_type start,
   std::vector <std::string>& data,
   std::string& sync_key) const
 {
-  // Break payload into lines.
-  auto lines = split (payload, '\n');
-
-  // Separate into data and key.
+  // Separate lines into data and key, copying each line once.
   // TODO Some syntax checking would be nice.
-  for (auto& i : lines)
+  if (start > payload.length ())
+    start = payload.length ();
+
+  data.reserve (std::count (payload.begin () + start, payload.end (), '\n') + 1);
+  while (start < payload.length ())
   {
-    if (i != "")
+    auto end = payload.find ('\n', start);
+    if (end == std::string::npos)
+      end = payload.length ();
+
+    if (end > start)
     {
-      if (i[0] == '{')
-        data.push_back (i);
+      if (payload[start] == '{')
+        data.emplace_back (payload, start, end - start);
       else
-        sync_key = i;
+        sync_key.assign (payload, start, end - start);
     }
+
+    start = end + 1;
   }
 
   _log->write (format ("[{1}] Client key '{2}' + {3} txns",
-                       _txn_count,
+                       _txn_id,
                        sync_key,
                        data.size ()));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void Daemon::load_server_data (
+std::string Daemon::user_file (
   const std::string& org,
   const std::string& password,
-  std::vector <std::string>& data) const
+  const std::string& name) const
 {
   Directory user_dir (_config.get ("root"));
   user_dir += "orgs";
   user_dir += org;
   user_dir += "users";
   user_dir += password;
-  File user_data (user_dir._data + "/tx.data");
+  return user_dir._data + "/" + name;
+}
 
-  if (user_data.exists ())
-    user_data.read (data);
-  else
-    user_data.create (0600);
+////////////////////////////////////////////////////////////////////////////////
+// Loads the records that follow the given byte offset in tx.data.
+void Daemon::load_server_data (
+  const std::string& org,
+  const std::string& password,
+  off_t offset,
+  std::vector <std::string>& data) const
+{
+  auto file = user_file (org, password, "tx.data");
+
+  auto removed = TxData (file).load (offset, data);
+  if (removed)
+    _log->write (format ("[{1}] Removed {2} bytes of incomplete sync from {3}",
+                         _txn_id,
+                         removed,
+                         file));
 
-  _log->write (format ("[{1}] Loaded {2} records", _txn_count, data.size ()));
+  _log->write (format ("[{1}] Loaded {2} records", _txn_id, data.size ()));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
+// Appends records to tx.data, where the given number of records precede them,
+// and adds them to the indexes.
 void Daemon::append_server_data (
   const std::string& org,
   const std::string& password,
-  const std::vector <std::string>& data) const
+  unsigned int records,
+  const std::vector <std::string>& data,
+  const std::vector <std::string>& uuids) const
 {
-  Directory user_dir (_config.get ("root"));
-  user_dir += "orgs";
-  user_dir += org;
-  user_dir += "users";
-  user_dir += password;
+  auto file = user_file (org, password, "tx.data");
 
-  // Write to a tmp copy of the data, then renamed afterwards. This guarantees
-  // that there are no partial writes to the real data file, which may occur
-  // in situations where there is no disk space.
-  File user_data     (user_dir._data     + "/tx.data");
-  File user_tmp_data (user_dir._data + "/tx.tmp.data");
+  // The records are flushed to disk before the client is given the new sync
+  // key.
+  auto offset = TxData (file).append (data);
+  _log->write (format ("[{1}] Wrote {2}", _txn_id, data.size ()));
 
-  // Create or copy, as necessary.
-  if (user_data.exists ())
-    File::copy (user_data._data, user_tmp_data._data);
-  else
-    user_tmp_data.create (0600);
+  // The data is already safely written, and a stale index is detected and
+  // rebuilt, so a failure here is not fatal.
+  try
+  {
+    SyncIndex index (file, user_file (org, password, "tx.index"));
+    index.add (data, offset, records);
 
-  // Store the data in the temporary file.
-  user_tmp_data.append (data);
+    UUIDIndex uuid_index (file, user_file (org, password, "tx.uuids"));
+    uuid_index.add (data, uuids, offset, records);
+  }
 
-  // Move the temp file to the real file, after closing it.
-  user_tmp_data.close ();
-  File::move (user_tmp_data._data, user_data._data);
+  catch (const std::string& e)
+  {
+    _log->write (format ("[{1}] {2}", _txn_id, e));
+  }
+}
 
-  _log->write (format ("[{1}] Wrote {2}", _txn_count, data.size ()));
+////////////////////////////////////////////////////////////////////////////////
+// The indexes and the snapshot only cache what is in tx.data, and are rebuilt
+// when stale, so failing to save one, for example when the disk is full, must
+// not fail the sync.  The file is removed, so that it is rebuilt next time.
+void Daemon::discard_cache (const std::string& file, const std::string& error) const
+{
+  _log->write (format ("[{1}] {2}", _txn_id, error));
+  ::unlink (file.c_str ());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -559,24 +924,45 @@ unsigned int Daemon::find_branch_point (
   if (! found)
     throw std::string ("Could not find the last sync transaction. Did you skip the 'task sync init' requirement?");
 
-  _log->write (format ("[{1}] Branch point: {2} --> {3}", _txn_count, sync_key, branch));
+  _log->write (format ("[{1}] Branch point: {2} --> {3}", _txn_id, sync_key, branch));
   return branch;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void Daemon::extract_subset (
   const std::vector <std::string>& data,
-  const unsigned int branch_point,
-  std::vector <Task>& subset) const
+  RecordCache& cache,
+  bool latest,
+  std::vector <std::string>& subset,
+  MergeSet& merges,
+  Arena& arena) const
 {
   unsigned int i;
 
   try
   {
-    if (branch_point < data.size ())
-      for (i = branch_point; i < data.size (); ++i)
-        if (data[i][0] == '{')
-          subset.push_back (Task (data[i]));
+    for (i = 0; i < data.size (); ++i)
+    {
+      if (data[i][0] == '{')
+      {
+        merges.subset (cache.get (i).get ("uuid"));
+        subset.push_back (data[i]);
+      }
+    }
+
+    // Keep only the last version of each task, in the order of those versions.
+    if (latest &&
+        subset.size () > merges.size ())
+    {
+      subset.clear ();
+      UUIDSet kept (16, UUIDSet::hasher (), UUIDSet::key_equal (), arena);
+      for (i = data.size (); i-- > 0; )
+        if (data[i][0] == '{' &&
+            kept.insert (cache.get (i).get ("uuid")).second)
+          subset.push_back (data[i]);
+
+      std::reverse (subset.begin (), subset.end ());
+    }
   }
 
   catch (const std::string& e)
@@ -584,98 +970,89 @@ void Daemon::extract_subset (
     throw e + format (" at line {1}", i);
   }
 
-  _log->write (format ("[{1}] Subset {2} tasks", _txn_count, subset.size ()));
-}
-
-////////////////////////////////////////////////////////////////////////////////
-bool Daemon::contains (
-  const std::vector <Task>& subset,
-  const std::string& uuid) const
-{
-  for (auto& i : subset)
-    if (uuid == i.get ("uuid"))
-      return true;
-
-  return false;
+  _log->write (format ("[{1}] Subset {2} tasks", _txn_id, subset.size ()));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 std::string Daemon::generate_payload (
-  const std::vector <Task>& subset,
+  const std::vector <std::string>& subset,
   const std::vector <std::string>& additions,
   const std::string& key) const
 {
+  // The payload is sized once, then filled.
+  auto length = key.length () + 1;
+  for (auto& s : subset)
+    length += s.length () + 1;
+
+  for (auto& a : additions)
+    length += a.length () + 1;
+
   std::string payload;
+  payload.reserve (length);
 
+  // Unmerged records are sent as stored, without a round trip through Task.
   for (auto& s : subset)
-    payload += s.composeJSON () + "\n";
+  {
+    payload += s;
+    payload += '\n';
+  }
 
   for (auto& a : additions)
-    payload += a + "\n";
+  {
+    payload += a;
+    payload += '\n';
+  }
 
-  payload += key + "\n";
+  payload += key;
+  payload += '\n';
 
   return payload;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Starting at branch_point and working backwards, find the first instance of a
-// task matching uuid.
+// Starting at branch_point and working backwards, find the first version of
+// the task, returning its position among the versions.
 unsigned int Daemon::find_common_ancestor (
-  const std::vector <std::string>& data,
+  const std::vector <UUIDIndex::Version>& versions,
   unsigned int branch_point,
   const std::string& uuid) const
 {
-  for (int i = (int) branch_point; i >= 0; --i)
-  {
-    if (data[i][0] == '{')
-    {
-      Task t (data[i]);
-      if (t.get ("uuid") == uuid)
-        return (unsigned int) i;
-    }
-  }
+  for (int i = (int) versions.size () - 1; i >= 0; --i)
+    if (versions[i].record <= branch_point)
+      return (unsigned int) i;
 
   throw std::string ("ERROR: Could not find common ancestor for ") + uuid + ". Did you skip the 'task sync init' requirement?";
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Extract tasks from the client list, with the given UUID, maintaining the
-// sequence.
+// Extract the given tasks from the client list, maintaining the sequence.
 void Daemon::get_client_mods (
   std::vector <Task>& mods,
-  const std::vector <std::string>& data,
-  const std::string& uuid) const
+  RecordCache& cache,
+  const std::vector <unsigned int>& records) const
 {
-  for (auto& line : data)
-  {
-    if (line[0] == '{')
-    {
-      Task t (line);
-      if (t.get ("uuid") == uuid)
-        mods.push_back (t);
-    }
-  }
+  for (auto& i : records)
+    mods.push_back (cache.get (i));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Extract tasks from the server list, with the given UUID, maintaining the
+// Read the versions of the task that follow the ancestor, maintaining the
 // sequence.
 void Daemon::get_server_mods (
   std::vector <Task>& mods,
-  const std::vector <std::string>& data,
-  const std::string& uuid,
-  unsigned int ancestor) const
+  const UUIDIndex& index,
+  const std::vector <UUIDIndex::Version>& versions,
+  unsigned int ancestor,
+  RecordCache& cache,
+  unsigned int first_record) const
 {
-  for (unsigned int i = ancestor + 1; i < data.size (); ++i)
-  {
-    if (data[i][0] == '{')
-    {
-      Task t (data[i]);
-      if (t.get ("uuid") == uuid)
-        mods.push_back (t);
-    }
-  }
+  // Versions from the first cached record on are already loaded, and likely
+  // parsed.
+  for (unsigned int i = ancestor + 1; i < versions.size (); ++i)
+    if (versions[i].record >= first_record)
+      mods.push_back (cache.get (versions[i].record - first_record));
+    else
+      mods.push_back (Task (index.read (versions[i])));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -702,7 +1079,7 @@ void Daemon::merge_sort (
     time_t mod_r = last_modification (*iter_r);
     if (mod_l < mod_r)
     {
-      _log->write (format ("[{1}] applying left {2} < {3}", _txn_count, mod_l, mod_r));
+      _log->write (format ("[{1}] applying left {2} < {3}", _txn_id, mod_l, mod_r));
       patch (combined, *prev_l, *iter_l);
       combined.set ("modified", (int) mod_l);
       prev_l = iter_l;
@@ -710,7 +1087,7 @@ void Daemon::merge_sort (
     }
     else
     {
-      _log->write (format ("[{1}] applying right {2} >= {3}", _txn_count, mod_l, mod_r));
+      _log->write (format ("[{1}] applying right {2} >= {3}", _txn_id, mod_l, mod_r));
       patch (combined, *prev_r, *iter_r);
       combined.set ("modified", (int) mod_r);
       prev_r = iter_r;
@@ -734,7 +1111,7 @@ void Daemon::merge_sort (
     ++iter_r;
   }
 
-  _log->write (format ("[{1}] Merge result {2}", _txn_count, combined.composeJSON ()));
+  _log->write (format ("[{1}] Merge result {2}", _txn_id, combined.composeJSON ()));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -777,14 +1154,14 @@ void Daemon::patch (
   std::vector <std::string>::iterator i;
   for (i = from_only.begin (); i != from_only.end (); ++i)
   {
-    _log->write (format ("[{1}] patch remove {2}", _txn_count, *i));
+    _log->write (format ("[{1}] patch remove {2}", _txn_id, *i));
     base.remove (*i);
   }
 
   // The to-only attributes must be added to base.
   for (auto& i : to_only)
   {
-    _log->write (format ("[{1}] patch add {2}={3}", _txn_count, i, to.get (i)));
+    _log->write (format ("[{1}] patch add {2}={3}", _txn_id, i, to.get (i)));
     base.set (i, to.get (i));
   }
 
@@ -793,7 +1170,7 @@ void Daemon::patch (
   {
     if (from.get (i) != to.get (i))
     {
-      _log->write (format ("[{1}] patch modify {2}={3}", _txn_count, i, to.get (i)));
+      _log->write (format ("[{1}] patch modify {2}={3}", _txn_id, i, to.get (i)));
       base.set (i, to.get (i));
     }
   }
@@ -852,10 +1229,8 @@ void command_server (Database& db)
   for (auto& i : _overrides)
     db._config->set (i.first, i.second);
 
-  // Provide a set of attribute types.
-  taskd_staticInitialize ();
-
   Log log;
+  SharedLog shared_log (log);
 
   try
   {
@@ -887,8 +1262,13 @@ void command_server (Database& db)
 
     // Create a taskd server object.
     Daemon server        (*db._config);
-    server.setLog        (&log);
-    server._db.setLog    (&log);
+    server.setLog        (&shared_log);
+    server._db.setLog    (&shared_log);
+    server._db.enableCache ();
+
+    auto indexes = db._config->get ("index.cache");
+    server.setIndexCache (indexes == "" ? 100 : db._config->getInteger ("index.cache"));
+
     server.setConfig     (db._config);
     server.setHost       (host);
     server.setPort       (port);
@@ -897,6 +1277,32 @@ void command_server (Database& db)
     server.setLimit      (db._config->getInteger ("request.limit"));
     server.setLogClients (db._config->getBoolean ("ip.log"));
 
+    if (db._config->get ("pool.size") != "")
+      server.setPoolSize (db._config->getInteger ("pool.size"));
+
+    if (db._config->getBoolean ("nonblocking"))
+      server.setNonBlocking ();
+
+    if (db._config->getBoolean ("keepalive"))
+    {
+      auto timeout  = db._config->get ("keepalive.timeout");
+      auto requests = db._config->get ("keepalive.requests");
+      server.setKeepAlive (timeout  == "" ? 5   : db._config->getInteger ("keepalive.timeout"),
+                           requests == "" ? 100 : db._config->getInteger ("keepalive.requests"));
+    }
+
+    auto handshake = db._config->get ("handshake.timeout");
+    auto read      = db._config->get ("read.timeout");
+    auto write     = db._config->get ("write.timeout");
+    server.setTimeouts (handshake == "" ? 30 : db._config->getInteger ("handshake.timeout"),
+                        read      == "" ? 60 : db._config->getInteger ("read.timeout"),
+                        write     == "" ? 60 : db._config->getInteger ("write.timeout"));
+
+    auto retry = db._config->get ("admission.retry");
+    server.setAdmission (db._config->getInteger ("admission.connections"),
+                         db._config->getInteger ("admission.wait"),
+                         retry == "" ? 10 : db._config->getInteger ("admission.retry"));
+
     // Optional daemonization.
     if (daemon)
     {
@@ -224,6 +224,7 @@ void command_diag (Database& config)
 
         std::cout << "      Server: " << config._config->get ("server") << '\n';
         std::cout << " Max Request: " << config._config->get ("request.limit") << " bytes\n";
+        std::cout << "     Workers: " << config._config->get ("pool.size") << '\n';
         std::cout << "     Ciphers: " << config._config->get ("ciphers") << '\n';
 
         // Show trust level.
@@ -58,6 +58,7 @@ void command_init (Database& db)
   db._config->set ("extensions", TASKD_EXTDIR);
   db._config->setIfBlank ("log",           "/tmp/taskd.log");
   db._config->setIfBlank ("queue.size",    "10");
+  db._config->setIfBlank ("pool.size",     "4");
   db._config->setIfBlank ("pid.file",      "/tmp/taskd.pid");
   db._config->setIfBlank ("ip.log",        "on");
   db._config->setIfBlank ("request.limit", "1048576");
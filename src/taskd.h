@@ -58,6 +58,7 @@ bool taskd_at_least (const std::string&, const std::string&);
 bool taskd_createDirectory (Directory&, bool);
 
 bool taskd_sendMessage (Config&, const std::string&, const Msg&, Msg&);
+bool taskd_sendMessages (Config&, const std::string&, const std::vector <Msg>&, std::vector <Msg>&);
 void taskd_renderMap (const std::map <std::string, std::string>&, const std::string&, const std::string&);
 
 bool taskd_is_org      (const Directory&, const std::string&);
@@ -66,8 +67,6 @@ bool taskd_is_user_key (const Directory&root, const std::string&, const std::str
 
 std::string taskd_error (const int);
 
-void taskd_staticInitialize ();
-
 // list template
 ////////////////////////////////////////////////////////////////////////////////
 template <class T> void listIntersect (const T& left, const T& right, T& join)
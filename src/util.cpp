@@ -38,6 +38,10 @@
 #include <util.h>
 #include <format.h>
 #include <shared.h>
+#include <JSON.h>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 // Handle the generation of UUIDs on FreeBSD in a separate implementation
 // of the uuid () function, since the API is quite different from Linux's.
@@ -107,4 +111,279 @@ time_t timegm (struct tm *tm)
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////
+// Finds the first byte that json::encode would change: a quote, backslash,
+// slash or control character.  Returns the length if there is none.
+static size_t scanPlain (const char* text, size_t length)
+{
+  for (size_t i = 0; i < length; ++i)
+  {
+    auto c = (unsigned char) text[i];
+    if (c < 0x20 || c == '"' || c == '\\' || c == '/')
+      return i;
+  }
+
+  return length;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+////////////////////////////////////////////////////////////////////////////////
+// SSE2 is always present on x86-64.
+static size_t scanSSE2 (const char* text, size_t length)
+{
+  const __m128i quote     = _mm_set1_epi8 ('"');
+  const __m128i backslash = _mm_set1_epi8 ('\\');
+  const __m128i slash     = _mm_set1_epi8 ('/');
+  const __m128i control   = _mm_set1_epi8 (0x1F);
+
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16)
+  {
+    __m128i chunk = _mm_loadu_si128 ((const __m128i*) (text + i));
+    __m128i found = _mm_or_si128 (
+                      _mm_or_si128 (_mm_cmpeq_epi8 (chunk, quote),
+                                    _mm_cmpeq_epi8 (chunk, backslash)),
+                      _mm_or_si128 (_mm_cmpeq_epi8 (chunk, slash),
+                                    _mm_cmpeq_epi8 (_mm_min_epu8 (chunk, control), chunk)));
+    int mask = _mm_movemask_epi8 (found);
+    if (mask)
+      return i + __builtin_ctz (mask);
+  }
+
+  return i + scanPlain (text + i, length - i);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+__attribute__ ((target ("avx2")))
+static size_t scanAVX2 (const char* text, size_t length)
+{
+  const __m256i quote     = _mm256_set1_epi8 ('"');
+  const __m256i backslash = _mm256_set1_epi8 ('\\');
+  const __m256i slash     = _mm256_set1_epi8 ('/');
+  const __m256i control   = _mm256_set1_epi8 (0x1F);
+
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32)
+  {
+    __m256i chunk = _mm256_loadu_si256 ((const __m256i*) (text + i));
+    __m256i found = _mm256_or_si256 (
+                      _mm256_or_si256 (_mm256_cmpeq_epi8 (chunk, quote),
+                                       _mm256_cmpeq_epi8 (chunk, backslash)),
+                      _mm256_or_si256 (_mm256_cmpeq_epi8 (chunk, slash),
+                                       _mm256_cmpeq_epi8 (_mm256_min_epu8 (chunk, control), chunk)));
+    unsigned int mask = (unsigned int) _mm256_movemask_epi8 (found);
+    if (mask)
+      return i + __builtin_ctz (mask);
+  }
+
+  // Mixing AVX and SSE code stalls, unless the upper halves of the registers
+  // are cleared first.
+  _mm256_zeroupper ();
+  return i + scanSSE2 (text + i, length - i);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool hasAVX2 ()
+{
+  static const bool avx2 = [] ()
+  {
+    __builtin_cpu_init ();
+    return __builtin_cpu_supports ("avx2");
+  } ();
+
+  return avx2;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// The widest scan the CPU supports, chosen once.
+static size_t scan (const char* text, size_t length)
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+  static const auto best = hasAVX2 () ? scanAVX2 : scanSSE2;
+  return best (text, length);
+#else
+  return scanPlain (text, length);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The scan that jsonEncode uses, with vectors of at most width bytes, where 1
+// is the plain loop, and 0 the widest the CPU supports.  Lets the vector scans
+// be compared with the plain one.
+size_t jsonScan (const char* text, size_t length, int width /* = 0 */)
+{
+  if (width == 0)
+    return scan (text, length);
+
+#if defined(__GNUC__) && defined(__x86_64__)
+  if (width >= 32 && hasAVX2 ())
+    return scanAVX2 (text, length);
+
+  if (width >= 16)
+    return scanSSE2 (text, length);
+#endif
+
+  return scanPlain (text, length);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Equivalent to json::encode, which changes only the bytes found by scan, so
+// the leading run of bytes it would not change is copied in bulk.  Most
+// descriptions need no escaping at all.
+const std::string jsonEncode (const std::string& input)
+{
+  auto plain = scan (input.data (), input.length ());
+  if (plain == input.length ())
+    return input;
+
+  return input.substr (0, plain) + json::encode (input.substr (plain));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// As above, but appends to output.
+void jsonEncode (std::string& output, const std::string& input)
+{
+  auto plain = scan (input.data (), input.length ());
+  output.append (input, 0, plain);
+  if (plain < input.length ())
+    output += json::encode (input.substr (plain));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Equivalent to json::decode, which only changes escape sequences, so all that
+// precedes the first backslash is copied in bulk.  memchr is vectorized by the
+// C library.
+const std::string jsonDecode (const std::string& input)
+{
+  auto backslash = (const char*) memchr (input.data (), '\\', input.length ());
+  if (! backslash)
+    return input;
+
+  auto plain = backslash - input.data ();
+  return input.substr (0, plain) + json::decode (input.substr (plain));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Days since 1970-01-01 of a proleptic Gregorian date.
+static long daysFromCivil (int year, int month, int day)
+{
+  year -= month <= 2;
+  long era = year / 400;
+  long yoe = year - era * 400;
+  long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void civilFromDays (long days, int& year, int& month, int& day)
+{
+  days += 719468;
+  long era = days / 146097;
+  long doe = days - era * 146097;
+  long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  long mp = (5 * doy + 2) / 153;
+  day   = doy - (153 * mp + 2) / 5 + 1;
+  month = mp + (mp < 10 ? 3 : -9);
+  year  = yoe + era * 400 + (month <= 2);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool digits (const char* text, int count, int& value)
+{
+  value = 0;
+  for (int i = 0; i < count; ++i)
+  {
+    if (text[i] < '0' || text[i] > '9')
+      return false;
+
+    value = value * 10 + (text[i] - '0');
+  }
 
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Converts the UTC form 'YYYYMMDDTHHMMSSZ' that Taskwarrior uses for dates in
+// JSON, from 1970 on.  Returns false for anything else, which is then left to
+// the general Datetime parser.
+bool isoToEpoch (const std::string& text, time_t& epoch)
+{
+  static const int month_days[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+  int year, month, day, hour, minute, second;
+  if (text.length () != 16 ||
+      text[8]  != 'T'      ||
+      text[15] != 'Z'      ||
+      ! digits (text.data (),      4, year)   ||
+      ! digits (text.data () + 4,  2, month)  ||
+      ! digits (text.data () + 6,  2, day)    ||
+      ! digits (text.data () + 9,  2, hour)   ||
+      ! digits (text.data () + 11, 2, minute) ||
+      ! digits (text.data () + 13, 2, second))
+    return false;
+
+  bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+  if (year < 1970                    ||
+      month < 1 || month > 12        ||
+      day < 1   || day > month_days[month - 1] ||
+      (month == 2 && day == 29 && ! leap) ||
+      hour > 23 || minute > 59 || second > 59)
+    return false;
+
+  epoch = (time_t) daysFromCivil (year, month, day) * 86400
+        + hour * 3600 + minute * 60 + second;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Converts an epoch, as stored in a date attribute, to 'YYYYMMDDTHHMMSSZ'.
+// Only plain epoch values that Datetime also reads as epochs are handled, and
+// anything else returns false, to be left to Datetime.
+bool epochToISO (const std::string& text, std::string& iso)
+{
+  if (text.length () < 9 ||
+      text.length () > 10)
+    return false;
+
+  long epoch = 0;
+  for (auto c : text)
+  {
+    if (c < '0' || c > '9')
+      return false;
+
+    epoch = epoch * 10 + (c - '0');
+  }
+
+  // Datetime reads epochs from 1980 on, as an int.
+  if (epoch < 315532800 ||
+      epoch > 2147483647)
+    return false;
+
+  int year, month, day;
+  civilFromDays (epoch / 86400, year, month, day);
+  int seconds = epoch % 86400;
+
+  // The digits are written directly, as snprintf costs more than the rest of
+  // the conversion together.
+  iso.resize (16);
+  auto put = [&iso] (int at, int value)
+  {
+    iso[at]     = '0' + value / 10;
+    iso[at + 1] = '0' + value % 10;
+  };
+
+  put (0, year / 100);
+  put (2, year % 100);
+  put (4, month);
+  put (6, day);
+  iso[8] = 'T';
+  put (9, seconds / 3600);
+  put (11, (seconds / 60) % 60);
+  put (13, seconds % 60);
+  iso[15] = 'Z';
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
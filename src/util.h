@@ -44,5 +44,13 @@ const std::string uuid ();
   time_t timegm (struct tm *tm);
 #endif
 
+size_t jsonScan (const char*, size_t, int width = 0);
+const std::string jsonEncode (const std::string&);
+void jsonEncode (std::string&, const std::string&);
+const std::string jsonDecode (const std::string&);
+
+bool isoToEpoch (const std::string&, time_t&);
+bool epochToISO (const std::string&, std::string&);
+
 #endif
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,190 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmake.h>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <cstdlib>
+#include <unordered_set>
+#include <unordered_map>
+#include <vector>
+#include <Arena.h>
+#include <Task.h>
+#include <Timer.h>
+#include <util.h>
+
+// Counts the heap allocations and time taken by the per-request objects of a
+// sync, as the server allocates them, on the heap and from an Arena:
+// - the Tasks parsed from the records;
+// - a hashed set of the task UUIDs;
+// - a hashed map of each UUID to its record numbers.
+// The strings inside these objects are on the heap either way.
+//
+// Usage: bench_arena [tasks]
+
+static unsigned long heap_allocations = 0;
+static unsigned long heap_bytes       = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+void* operator new (std::size_t size)
+{
+  ++heap_allocations;
+  heap_bytes += size;
+
+  void* memory = malloc (size ? size : 1);
+  if (! memory)
+    throw std::bad_alloc ();
+
+  return memory;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void operator delete (void* memory) noexcept
+{
+  free (memory);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void operator delete (void* memory, std::size_t) noexcept
+{
+  free (memory);
+}
+
+typedef std::unordered_set <std::string,
+                            std::hash <std::string>,
+                            std::equal_to <std::string>,
+                            ArenaAllocator <std::string>> ArenaSet;
+typedef std::unordered_map <std::string,
+                            std::vector <unsigned int>,
+                            std::hash <std::string>,
+                            std::equal_to <std::string>,
+                            ArenaAllocator <std::pair <const std::string, std::vector <unsigned int>>>> ArenaMap;
+
+////////////////////////////////////////////////////////////////////////////////
+// Measures from construction to destruction.
+class Measure
+{
+public:
+  Measure (const std::string& name)
+  : _name (name)
+  , _allocations (heap_allocations)
+  , _bytes (heap_bytes)
+  {
+    _timer.start ();
+  }
+
+  ~Measure ()
+  {
+    _timer.stop ();
+    std::cout << std::left  << std::setw (16) << _name
+              << std::right << std::setw (10) << heap_allocations - _allocations << " allocations"
+              << std::setw (12) << heap_bytes - _bytes << " bytes"
+              << std::setw (10) << _timer.total_us () << " us\n";
+  }
+
+private:
+  std::string   _name;
+  unsigned long _allocations;
+  unsigned long _bytes;
+  Timer         _timer;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+int main (int argc, char** argv)
+{
+  int count = argc > 1 ? atoi (argv[1]) : 10000;
+
+  std::vector <std::string> records;
+  std::vector <std::string> uuids;
+  for (int i = 0; i < count; ++i)
+  {
+    uuids.push_back (uuid ());
+    records.push_back ("{\"description\":\"task " + std::to_string (i) + "\","
+                       "\"entry\":\"20180101T000000Z\",\"status\":\"pending\","
+                       "\"tags\":[\"home\",\"next\"],\"uuid\":\"" + uuids.back () + "\"}");
+  }
+
+  std::cout << count << " tasks\n";
+
+  {
+    Measure measure ("tasks, heap");
+    std::vector <Task*> tasks;
+    for (auto& record : records)
+      tasks.push_back (new Task (record));
+
+    for (auto task : tasks)
+      delete task;
+  }
+
+  {
+    Measure measure ("tasks, arena");
+    Arena arena;
+    std::vector <Task*, ArenaAllocator <Task*>> tasks (ArenaAllocator <Task*> {arena});
+    for (auto& record : records)
+    {
+      void* memory = arena.allocate (sizeof (Task), alignof (Task));
+      tasks.push_back (new (memory) Task (record));
+    }
+
+    for (auto task : tasks)
+      task->~Task ();
+  }
+
+  {
+    Measure measure ("set, heap");
+    std::unordered_set <std::string> set;
+    for (auto& uuid : uuids)
+      set.insert (uuid);
+  }
+
+  {
+    Measure measure ("set, arena");
+    Arena arena;
+    ArenaSet set (16, ArenaSet::hasher (), ArenaSet::key_equal (), arena);
+    for (auto& uuid : uuids)
+      set.insert (uuid);
+  }
+
+  {
+    Measure measure ("map, heap");
+    std::unordered_map <std::string, std::vector <unsigned int>> map;
+    for (unsigned int i = 0; i < uuids.size (); ++i)
+      map[uuids[i]].push_back (i);
+  }
+
+  {
+    Measure measure ("map, arena");
+    Arena arena;
+    ArenaMap map (16, ArenaMap::hasher (), ArenaMap::key_equal (), arena);
+    for (unsigned int i = 0; i < uuids.size (); ++i)
+      map[uuids[i]].push_back (i);
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+#include <cmake.h>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <Datetime.h>
+#include <Timer.h>
+#include <util.h>
+
+// Compares isoToEpoch and epochToISO with the Datetime conversions that task
+// JSON used before, and still uses for unusual dates, over dates spread across
+// the years Datetime reads as epochs.
+//
+// Usage: bench_date [dates [rounds]]
+
+////////////////////////////////////////////////////////////////////////////////
+static void report (const std::string& name, const Timer& timer, size_t count, size_t check)
+{
+  std::cout << std::left << std::setw (28) << name
+            << std::right << std::setw (10) << timer.total_us () << " us"
+            << std::setw (10) << std::fixed << std::setprecision (1)
+            << (timer.total_us () ? count / (double) timer.total_us () : 0.0) << " M/s"
+            << "  (" << check << ")\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main (int argc, char** argv)
+{
+  int count  = argc > 1 ? atoi (argv[1]) : 10000;
+  int rounds = argc > 2 ? atoi (argv[2]) : 20;
+
+  // From 1980 to 2038, the range that epochToISO accepts.
+  std::minstd_rand random (42);
+  std::vector <time_t> epochs;
+  std::vector <std::string> texts;
+  std::vector <std::string> isos;
+  for (int i = 0; i < count; ++i)
+  {
+    time_t epoch = 315532800 + random () % (2147483647 - 315532800);
+    epochs.push_back (epoch);
+    texts.push_back (std::to_string ((long long) epoch));
+    isos.push_back (Datetime (epoch).toISO ());
+  }
+
+  size_t total = (size_t) count * rounds;
+  std::cout << count << " dates, " << rounds << " rounds\n";
+
+  // The check sums keep the work from being optimized away, and agree when
+  // the conversions do.
+  {
+    size_t check = 0;
+    Timer timer;
+    timer.start ();
+    for (int r = 0; r < rounds; ++r)
+      for (auto& iso : isos)
+        check += Datetime (iso).toEpochString ().back ();
+    timer.stop ();
+    report ("Datetime (iso)", timer, total, check);
+  }
+
+  {
+    size_t check = 0;
+    Timer timer;
+    timer.start ();
+    for (int r = 0; r < rounds; ++r)
+      for (auto& iso : isos)
+      {
+        time_t epoch = 0;
+        isoToEpoch (iso, epoch);
+        check += std::to_string ((long long) epoch).back ();
+      }
+    timer.stop ();
+    report ("isoToEpoch", timer, total, check);
+  }
+
+  {
+    size_t check = 0;
+    Timer timer;
+    timer.start ();
+    for (int r = 0; r < rounds; ++r)
+      for (auto& text : texts)
+        check += Datetime (text).toISO ()[14];
+    timer.stop ();
+    report ("Datetime (text).toISO", timer, total, check);
+  }
+
+  {
+    size_t check = 0;
+    Timer timer;
+    timer.start ();
+    for (int r = 0; r < rounds; ++r)
+      for (auto& epoch : epochs)
+        check += Datetime (epoch).toISO ()[14];
+    timer.stop ();
+    report ("Datetime (epoch).toISO", timer, total, check);
+  }
+
+  {
+    size_t check = 0;
+    std::string iso;
+    Timer timer;
+    timer.start ();
+    for (int r = 0; r < rounds; ++r)
+      for (auto& text : texts)
+      {
+        epochToISO (text, iso);
+        check += iso[14];
+      }
+    timer.stop ();
+    report ("epochToISO", timer, total, check);
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,182 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmake.h>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <JSON.h>
+#include <Timer.h>
+#include <util.h>
+
+// Compares jsonEncode and jsonDecode, and each of the scans behind jsonEncode,
+// with json::encode and json::decode, over a corpus that resembles task
+// descriptions and annotations: mostly plain text of varying length, some with
+// URLs, quotes or accented letters.
+//
+// Usage: bench_json [tasks [rounds]]
+
+////////////////////////////////////////////////////////////////////////////////
+static std::vector <std::string> corpus (int count)
+{
+  static const char* words[] = {"call", "mail", "the", "report", "review",
+                                "fix", "bug", "in", "sync", "server", "buy",
+                                "milk", "before", "friday", "plan", "trip",
+                                "caf\xc3\xa9", "na\xc3\xafve", "meeting"};
+  static const char* extras[] = {" see https://example.com/issue/42",
+                                 " \"urgent\"",
+                                 " path C:\\temp",
+                                 "\nsecond line"};
+
+  std::minstd_rand random (42);
+  std::vector <std::string> result;
+  for (int i = 0; i < count; ++i)
+  {
+    std::string text;
+    int length = 2 + random () % (i % 10 ? 8 : 40);
+    for (int w = 0; w < length; ++w)
+    {
+      if (w)
+        text += ' ';
+      text += words[random () % (sizeof (words) / sizeof (words[0]))];
+    }
+
+    // One in five has something to escape.
+    if (random () % 5 == 0)
+      text += extras[random () % (sizeof (extras) / sizeof (extras[0]))];
+
+    result.push_back (text);
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void report (const std::string& name, const Timer& timer, size_t bytes, size_t check)
+{
+  std::cout << std::left << std::setw (24) << name
+            << std::right << std::setw (10) << timer.total_us () << " us"
+            << std::setw (10) << std::fixed << std::setprecision (1)
+            << (timer.total_us () ? bytes / (double) timer.total_us () : 0.0) << " MB/s"
+            << "  (" << check << ")\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main (int argc, char** argv)
+{
+  int count  = argc > 1 ? atoi (argv[1]) : 10000;
+  int rounds = argc > 2 ? atoi (argv[2]) : 20;
+
+  auto texts = corpus (count);
+  std::vector <std::string> encoded;
+  size_t bytes = 0;
+  for (auto& text : texts)
+  {
+    encoded.push_back (json::encode (text));
+    bytes += text.length ();
+  }
+
+  bytes *= rounds;
+  std::cout << count << " texts, " << bytes / rounds << " bytes, " << rounds << " rounds\n";
+
+  // The check sums keep the work from being optimized away.
+  for (auto width : {1, 16, 32})
+  {
+    size_t check = 0;
+    Timer timer;
+    timer.start ();
+    for (int r = 0; r < rounds; ++r)
+      for (auto& text : texts)
+        check += jsonScan (text.data (), text.length (), width);
+    timer.stop ();
+    report ("jsonScan width " + std::to_string (width), timer, bytes, check);
+  }
+
+  {
+    size_t check = 0;
+    Timer timer;
+    timer.start ();
+    for (int r = 0; r < rounds; ++r)
+      for (auto& text : texts)
+        check += json::encode (text).length ();
+    timer.stop ();
+    report ("json::encode", timer, bytes, check);
+  }
+
+  {
+    size_t check = 0;
+    Timer timer;
+    timer.start ();
+    for (int r = 0; r < rounds; ++r)
+      for (auto& text : texts)
+        check += jsonEncode (text).length ();
+    timer.stop ();
+    report ("jsonEncode", timer, bytes, check);
+  }
+
+  {
+    size_t check = 0;
+    std::string out;
+    Timer timer;
+    timer.start ();
+    for (int r = 0; r < rounds; ++r)
+      for (auto& text : texts)
+      {
+        out.clear ();
+        jsonEncode (out, text);
+        check += out.length ();
+      }
+    timer.stop ();
+    report ("jsonEncode (append)", timer, bytes, check);
+  }
+
+  {
+    size_t check = 0;
+    Timer timer;
+    timer.start ();
+    for (int r = 0; r < rounds; ++r)
+      for (auto& text : encoded)
+        check += json::decode (text).length ();
+    timer.stop ();
+    report ("json::decode", timer, bytes, check);
+  }
+
+  {
+    size_t check = 0;
+    Timer timer;
+    timer.start ();
+    for (int r = 0; r < rounds; ++r)
+      for (auto& text : encoded)
+        check += jsonDecode (text).length ();
+    timer.stop ();
+    report ("jsonDecode", timer, bytes, check);
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
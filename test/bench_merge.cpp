@@ -0,0 +1,136 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmake.h>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+#include <Arena.h>
+#include <MergeSet.h>
+#include <Timer.h>
+#include <util.h>
+
+// Times the UUID bookkeeping of the sync merge loop, where every client task
+// is also in the server subset, so that every task is merged.  The loop as it
+// was scanned the subset for each client task, searched a vector of merged
+// UUIDs, and scanned the client tasks again for each merge.  The loop as it is
+// uses a MergeSet in the request arena, as Daemon::handle_sync does.  Each
+// doubling of the task count should double the hashed time, and quadruple the
+// scanned time.
+//
+// Usage: bench_merge [tasks]
+
+////////////////////////////////////////////////////////////////////////////////
+static unsigned long scanned (
+  const std::vector <std::string>& client,
+  const std::vector <std::string>& subset)
+{
+  unsigned long mods = 0;
+  std::vector <std::string> already_seen;
+  for (auto& uuid : client)
+  {
+    if (std::find (subset.begin (), subset.end (), uuid) == subset.end ())
+      continue;
+
+    if (std::find (already_seen.begin (), already_seen.end (), uuid) != already_seen.end ())
+      continue;
+
+    already_seen.push_back (uuid);
+
+    for (auto& other : client)
+      if (other == uuid)
+        ++mods;
+  }
+
+  return mods;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static unsigned long hashed (
+  const std::vector <std::string>& client,
+  const std::vector <std::string>& subset)
+{
+  Arena arena;
+  MergeSet merges (arena);
+  for (auto& uuid : subset)
+    merges.subset (uuid);
+
+  for (unsigned int i = 0; i < client.size (); ++i)
+    merges.client (client[i], i);
+
+  unsigned long mods = 0;
+  for (auto& uuid : client)
+  {
+    if (! merges.contains (uuid))
+      continue;
+
+    if (! merges.first (uuid))
+      continue;
+
+    mods += merges.records (uuid).size ();
+  }
+
+  return mods;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main (int argc, char** argv)
+{
+  int largest = argc > 1 ? atoi (argv[1]) : 8000;
+
+  std::cout << std::setw (8) << "tasks"
+            << std::setw (14) << "scanned us"
+            << std::setw (14) << "hashed us" << "\n";
+
+  for (int count = largest / 8; count <= largest; count *= 2)
+  {
+    std::vector <std::string> client;
+    for (int i = 0; i < count; ++i)
+      client.push_back (uuid ());
+
+    std::vector <std::string> subset (client.rbegin (), client.rend ());
+
+    Timer scan;
+    scan.start ();
+    auto scan_mods = scanned (client, subset);
+    scan.stop ();
+
+    Timer hash;
+    hash.start ();
+    auto hash_mods = hashed (client, subset);
+    hash.stop ();
+
+    std::cout << std::setw (8) << count
+              << std::setw (14) << scan.total_us ()
+              << std::setw (14) << hash.total_us ()
+              << (scan_mods == hash_mods ? "" : "  mismatch") << "\n";
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmake.h>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <unistd.h>
+#include <Server.h>
+#include <TLSClient.h>
+#include <Timer.h>
+
+// Times framed responses of several sizes over loopback TLS, from a server in
+// each I/O mode to one keep-alive client, and the copy of each response that
+// prepending the length header by concatenation would cost.
+//
+// Usage: bench_send [certs [port]]
+//
+// Two servers are started, on port and port + 1.  The certificates default to
+// those in test/test_certs.
+
+////////////////////////////////////////////////////////////////////////////////
+// Responds with the number of bytes requested.
+class Responder : public Server
+{
+public:
+  void handler (const std::string& input, std::string& output)
+  {
+    output.assign (std::stoul (input), 'x');
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static void serve (const std::string& certs, const std::string& port, bool blocking)
+{
+  std::thread ([=] ()
+  {
+    Responder server;
+    server.setHost     ("127.0.0.1");
+    server.setPort     (port);
+    server.setFamily   ("IPv4");
+    server.setPoolSize (2);
+    server.setCAFile   (certs + "/ca.cert.pem");
+    server.setCertFile (certs + "/server.cert.pem");
+    server.setKeyFile  (certs + "/server.key.pem");
+    server.setKeepAlive (60, 1000);
+    if (! blocking)
+      server.setNonBlocking ();
+
+    server.beginServer ();
+  }).detach ();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main (int argc, char** argv)
+{
+  std::string certs = argc > 1 ? argv[1] : "test_certs";
+  int port          = argc > 2 ? atoi (argv[2]) : 53599;
+
+  serve (certs, std::to_string (port),     true);
+  serve (certs, std::to_string (port + 1), false);
+  sleep (1);
+
+  const int rounds = 10;
+  std::cout << std::setw (12) << "mode"
+            << std::setw (8)  << "MB"
+            << std::setw (16) << "ms/response"
+            << std::setw (12) << "copy ms" << "\n";
+
+  for (auto blocking : {true, false})
+  {
+    TLSClient client;
+    client.trust (TLSClient::allow_all);
+    client.limit (0);
+    client.init (certs + "/ca.cert.pem", certs + "/client.cert.pem", certs + "/client.key.pem");
+    client.connect ("127.0.0.1", std::to_string (blocking ? port : port + 1));
+
+    for (auto megabytes : {1, 8, 32})
+    {
+      auto size = std::to_string (megabytes << 20);
+      std::string response;
+
+      // The first response warms up both ends.
+      client.send (size);
+      client.recv (response);
+
+      Timer timer;
+      timer.start ();
+      for (int i = 0; i < rounds; ++i)
+      {
+        client.send (size);
+        client.recv (response);
+      }
+      timer.stop ();
+
+      unsigned long check = 0;
+      Timer copy;
+      copy.start ();
+      for (int i = 0; i < rounds; ++i)
+      {
+        std::string framed = "XXXX" + response;
+        check += framed.length ();
+      }
+      copy.stop ();
+
+      std::cout << std::setw (12) << (blocking ? "blocking" : "nonblocking")
+                << std::setw (8)  << megabytes
+                << std::setw (16) << std::fixed << std::setprecision (2) << timer.total_us () / 1000.0 / rounds
+                << std::setw (12) << copy.total_us () / 1000.0 / rounds
+                << (check == rounds * response.length () + rounds * 4 ? "" : "  mismatch") << "\n";
+    }
+  }
+
+  // The servers run until the process ends.
+  std::cout.flush ();
+  _exit (0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,149 @@
+#!/usr/bin/env python2.7
+# -*- coding: utf-8 -*-
+###############################################################################
+#
+# Copyright 2006 - 2018, Paul Beckingham, Federico Hernandez.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included
+# in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+# http://www.opensource.org/licenses/mit-license.php
+#
+###############################################################################
+
+
+import sys
+import os
+import socket
+import ssl
+import struct
+import subprocess
+import unittest
+# Ensure python finds the local simpletap module
+sys.path.append(os.path.dirname(os.path.abspath(__file__)))
+
+from basetest import Taskd, ServerTestCase
+from basetest.utils import (DEFAULT_CERT_PATH, find_unused_port, port_used,
+                            release_port, wait_condition)
+
+
+# Test methods available:
+#     self.assertEqual(a, b)
+#     self.assertNotEqual(a, b)
+#     self.assertTrue(x)
+#     self.assertFalse(x)
+#     self.assertIs(a, b)
+#     self.assertIsNot(a, b)
+#     self.assertIsNone(x)
+#     self.assertIsNotNone(x)
+#     self.assertIn(a, b)
+#     self.assertNotIn(a, b)
+#     self.assertIsInstance(a, b)
+#     self.assertNotIsInstance(a, b)
+#     self.assertRaises(e)
+#     self.assertRegexpMatches(t, r)
+#     self.assertNotRegexpMatches(t, r)
+#     self.tap("")
+
+LIMIT = 1000
+
+
+class TestRequestLimit(ServerTestCase):
+    def setUp(self):
+        """Executed before each test in the class"""
+        self.td = Taskd()
+        self.td('init --data {0}'.format(self.td.datadir))
+
+        self.port = find_unused_port("127.0.0.1")
+        self.td.config("server", "127.0.0.1:{0}".format(self.port))
+        self.td.config("family", "IPv4")
+        self.td.config("log", os.path.join(self.td.datadir, "taskd.log"))
+        self.td.config("ca.cert", os.path.join(DEFAULT_CERT_PATH, "ca.cert.pem"))
+        self.td.config("server.cert", os.path.join(DEFAULT_CERT_PATH, "server.cert.pem"))
+        self.td.config("server.key", os.path.join(DEFAULT_CERT_PATH, "server.key.pem"))
+        self.td.config("request.limit", str(LIMIT))
+        self.server = None
+
+    def tearDown(self):
+        """Executed after each test in the class"""
+        if self.server is not None:
+            self.server.terminate()
+            self.server.wait()
+
+        release_port(self.port)
+
+    def start(self):
+        """Runs the server, and waits until it accepts connections"""
+        self.server = subprocess.Popen(
+            [self.td.taskd, "server", "--data", self.td.datadir],
+            env=self.td.env)
+
+        listening = wait_condition(
+            lambda: True if port_used("127.0.0.1", self.port) else None,
+            timeout=5)
+        self.assertTrue(listening, "Server is not listening")
+
+    def request(self, body):
+        """Sends one framed request, and returns the response"""
+        context = ssl.SSLContext(ssl.PROTOCOL_SSLv23)
+        context.verify_mode = ssl.CERT_NONE
+        context.load_cert_chain(os.path.join(DEFAULT_CERT_PATH, "client.cert.pem"),
+                                os.path.join(DEFAULT_CERT_PATH, "client.key.pem"))
+
+        client = context.wrap_socket(socket.create_connection(("127.0.0.1", self.port), 5))
+        try:
+            client.sendall(struct.pack(">I", len(body) + 4) + body)
+
+            def read(count):
+                data = b""
+                while len(data) < count:
+                    chunk = client.recv(count - len(data))
+                    if not chunk:
+                        break
+                    data += chunk
+                return data
+
+            header = read(4)
+            self.assertEqual(len(header), 4, "No response")
+            return read(struct.unpack(">I", header)[0] - 4).decode("utf8")
+        finally:
+            client.close()
+
+    def test_over_limit(self):
+        """A request over request.limit is answered with 504"""
+        self.start()
+        response = self.request(b"type: sync\n\n" + b"x" * (2 * LIMIT))
+        self.assertIn("code: 504", response)
+
+    def test_just_under_limit(self):
+        """A request one byte under request.limit is not rejected for size"""
+        self.start()
+        body = b"type: unknown\n\n"
+        response = self.request(body + b"x" * (LIMIT - 1 - len(body)))
+        self.assertNotIn("code: 504", response)
+
+    def test_over_limit_nonblocking(self):
+        """A request over request.limit is answered with 504, when non-blocking"""
+        self.td.config("nonblocking", "on")
+        self.start()
+        response = self.request(b"type: sync\n\n" + b"x" * (2 * LIMIT))
+        self.assertIn("code: 504", response)
+
+if __name__ == "__main__":
+    from simpletap import TAPTestRunner
+    unittest.main(testRunner=TAPTestRunner())
@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmake.h>
+#include <iostream>
+#include <Datetime.h>
+#include <JSON.h>
+#include <Task.h>
+#include <test.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// A task parsed from a string, which takes the streaming parser, must match
+// the same task parsed from a json::object tree.
+static void compare (UnitTest& t, const std::string& line)
+{
+  Task streamed (line);
+
+  json::value* root = json::parse (line);
+  Task tree ((json::object*) root);
+  delete root;
+
+  t.is (streamed.composeF4 (), tree.composeF4 (), "Task::parseJSON " + line);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// A task with one attribute set to value must compose to the JSON that the
+// stream-based writer produced.
+static void compose (
+  UnitTest& t,
+  const std::string& name,
+  const std::string& value,
+  const std::string& expected)
+{
+  Task task;
+  task.set (name, value);
+
+  t.is (task.composeJSON (),
+        "{" + expected + "}",
+        "Task::composeJSON " + name + "='" + value + "'");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main (int, char**)
+{
+  UnitTest t (23);
+
+  // Plain strings and dates.
+  compare (t, "{\"description\":\"one\",\"entry\":\"20180101T000000Z\",\"status\":\"pending\",\"uuid\":\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a001\"}");
+
+  // Whitespace, and names out of order.
+  compare (t, " { \"uuid\" : \"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a002\" , \"status\" : \"pending\" , \"description\" : \"two\" } ");
+
+  // Escapes are decoded.
+  compare (t, "{\"description\":\"say \\\"hi\\\" \\u00e9 \\\\ \\t\",\"uuid\":\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a003\"}");
+
+  // Tags, as an array and as a string.
+  compare (t, "{\"description\":\"four\",\"tags\":[\"a\",\"b\",\"c\"],\"uuid\":\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a004\"}");
+  compare (t, "{\"description\":\"five\",\"tags\":\"a\",\"uuid\":\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a005\"}");
+
+  // Dependencies, as an array and as a comma-separated string.
+  compare (t, "{\"depends\":[\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a001\",\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a002\"],\"description\":\"six\",\"uuid\":\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a006\"}");
+  compare (t, "{\"depends\":\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a001,a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a002\",\"description\":\"seven\",\"uuid\":\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a007\"}");
+
+  // Annotations.
+  compare (t, "{\"annotations\":[{\"entry\":\"20180101T000000Z\",\"description\":\"x \\\"y\\\"\"},{\"description\":\"z\",\"entry\":\"20180102T000000Z\"}],\"description\":\"eight\",\"uuid\":\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a008\"}");
+
+  // Ignored id and urgency, numbers and literals.
+  compare (t, "{\"description\":\"nine\",\"id\":3,\"imask\":2,\"urgency\":4.5,\"orphan\":true,\"uuid\":\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a009\"}");
+
+  // Standardized modification, and the first of duplicate names.
+  compare (t, "{\"description\":\"ten\",\"modified\":\"20180103T000000Z\",\"modification\":\"20180104T000000Z\",\"description\":\"dup\",\"uuid\":\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a010\"}");
+
+  // Orphans.
+  compare (t, "{\"description\":\"eleven\",\"orphan\":\"\\u00e9\",\"uuid\":\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a011\"}");
+
+  // Values left to the full parser.
+  compare (t, "{\"description\":\"twelve\",\"orphan\":{\"a\":[1,2]},\"uuid\":\"a6f7e3f2-7d4e-4d09-9e1a-f4e4f3a7a012\"}");
+
+  // Dates, including a deleted one, which is not written.
+  compose (t, "due", "1514764800", "\"due\":\"" + Datetime ("1514764800").toISO () + "\"");
+  compose (t, "due", "315532799",  "\"due\":\"" + Datetime ("315532799").toISO () + "\"");
+  compose (t, "due", "",           "");
+
+  // Lists hold the same elements as split (value, ',').
+  compose (t, "tags",    "",      "");
+  compose (t, "tags",    "a",     "\"tags\":[\"a\"]");
+  compose (t, "tags",    "a,b",   "\"tags\":[\"a\",\"b\"]");
+  compose (t, "tags",    "a,",    "\"tags\":[\"a\"]");
+  compose (t, "tags",    ",",     "\"tags\":[\"\"]");
+  compose (t, "tags",    "a,,b",  "\"tags\":[\"a\",\"\",\"b\"]");
+  compose (t, "tags",    ",a",    "\"tags\":[\"\",\"a\"]");
+  compose (t, "depends", "x,y,",  "\"depends\":[\"x\",\"y\"]");
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
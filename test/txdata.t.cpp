@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+#include <cmake.h>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <TxData.h>
+#include <test.h>
+
+static const char* file = "txdata.t.data";
+
+////////////////////////////////////////////////////////////////////////////////
+// Writes raw bytes to the end of the file, as an interrupted append would.
+static void tear (const std::string& bytes)
+{
+  FILE* out = fopen (file, "a");
+  fwrite (bytes.data (), 1, bytes.length (), out);
+  fclose (out);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static off_t size ()
+{
+  struct stat st;
+  return ::stat (file, &st) ? -1 : st.st_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Task records begin with '{', and anything else is a sync key.
+int main (int, char**)
+{
+  UnitTest t (32);
+  unlink (file);
+
+  TxData data (file);
+  std::vector <std::string> records;
+
+  // A missing file is created empty.
+  t.is ((int) data.load (0, records), 0,                 "load: missing file, nothing removed");
+  t.is ((int) records.size (), 0,                        "load: missing file, no records");
+  t.is ((int) size (), 0,                                "load: missing file created");
+
+  // Appends return the offset of their first record.
+  t.is ((int) data.append ({"{one}\n", "{two}\n", "k1\n"}), 0, "append: first at offset 0");
+  t.is ((int) data.append ({"{three}\n", "k2\n"}), 15,         "append: second at offset 15");
+
+  data.load (0, records);
+  t.is ((int) records.size (), 5,                        "load: 5 records");
+  t.is (records[0], "{one}",                             "load: newline removed");
+  t.is (records[4], "k2",                                "load: last record");
+
+  records.clear ();
+  data.load (15, records);
+  t.is ((int) records.size (), 2,                        "load: from offset, 2 records");
+  t.is (records[0], "{three}",                           "load: from offset, first record");
+
+  // A partial last record is removed, and the complete ones still load.
+  tear ("{four}\nk3\n{fi");
+  records.clear ();
+  t.is ((int) data.load (0, records), 3,                 "load: torn record, 3 bytes removed");
+  t.is ((int) records.size (), 7,                        "load: torn record, 7 records");
+  t.is (records[6], "k3",                                "load: torn record, last complete record");
+  t.is ((int) size (), 36,                               "load: torn record, file truncated");
+
+  // Complete task records without their sync key are also removed.
+  tear ("{five}\n{six}\n");
+  records.clear ();
+  t.is ((int) data.load (0, records), 13,                "load: no sync key, 13 bytes removed");
+  t.is ((int) records.size (), 7,                        "load: no sync key, 7 records");
+  t.is (records[6], "k3",                                "load: no sync key, last record is a key");
+  t.is ((int) size (), 36,                               "load: no sync key, file truncated");
+
+  // And so are both together.
+  tear ("{seven}\n{ei");
+  records.clear ();
+  t.is ((int) data.load (0, records), 11,                "load: no sync key, torn record, 11 bytes removed");
+  t.is ((int) records.size (), 7,                        "load: no sync key, torn record, 7 records");
+  t.is ((int) size (), 36,                               "load: no sync key, torn record, file truncated");
+
+  // The next append starts after the last key.
+  t.is ((int) data.append ({"{nine}\n", "k4\n"}), 36,  "append: after removal, at offset 36");
+  records.clear ();
+  data.load (0, records);
+  t.is ((int) records.size (), 9,                        "load: after append, 9 records");
+  t.is (records[7], "{nine}",                            "load: after append, new task");
+  t.is (records[8], "k4",                                "load: after append, new key");
+
+  // An interrupted append after the offset is removed without touching
+  // earlier data.
+  tear ("{ten}\n");
+  records.clear ();
+  t.is ((int) data.load (36, records), 6,                "load: from offset, 6 bytes removed");
+  t.is ((int) records.size (), 2,                        "load: from offset, 2 records");
+  t.is ((int) size (), 46,                               "load: from offset, file truncated");
+
+  tear ("{x}\n");
+  records.clear ();
+  t.is ((int) data.load (46, records), 4,                "load: from offset, no key at all, 4 bytes removed");
+  t.is ((int) size (), 46,                               "load: from offset, no key at all, file truncated");
+
+  // A file holding only an interrupted append loads empty.
+  unlink (file);
+  tear ("{a}\n{b}\n{c");
+  records.clear ();
+  data.load (0, records);
+  t.is ((int) records.size (), 0,                        "load: only interrupted append, no records");
+  t.is ((int) size (), 0,                                "load: only interrupted append, file emptied");
+
+  unlink (file);
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,214 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2010 - 2018, Göteborg Bit Factory.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// http://www.opensource.org/licenses/mit-license.php
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmake.h>
+#include <vector>
+#include <time.h>
+#include <JSON.h>
+#include <util.h>
+#include <test.h>
+
+// Lengths either side of the 16 and 32 byte vector blocks.
+static const size_t lengths[] = {0, 1, 15, 16, 17, 31, 32, 33, 47, 48, 49, 63, 64, 65};
+
+// Bytes that json::encode may change, and bytes that it leaves alone, but that
+// a signed comparison could mistake for control characters.
+static const std::string special = "\"\\/\n\t\x01\x1f";
+static const std::string plain   = " ~\x7f\x80\xe9\xff";
+
+////////////////////////////////////////////////////////////////////////////////
+// A string of the given length with nothing to escape, and copies of it with
+// each byte in turn replaced by each special byte, alone and with a quote at
+// the end.
+static std::vector <std::string> variants (size_t length)
+{
+  std::vector <std::string> result;
+  std::string base;
+  for (size_t i = 0; i < length; ++i)
+    base += plain[i % plain.length ()];
+
+  result.push_back (base);
+  for (size_t i = 0; i < length; ++i)
+    for (auto c : special)
+    {
+      std::string one (base);
+      one[i] = c;
+      result.push_back (one);
+
+      if (i + 1 < length)
+      {
+        one[length - 1] = '"';
+        result.push_back (one);
+      }
+    }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The ISO form of an epoch, from the C library.
+static std::string iso (time_t epoch)
+{
+  struct tm t;
+  gmtime_r (&epoch, &t);
+
+  char buffer[32];
+  strftime (buffer, sizeof (buffer), "%Y%m%dT%H%M%SZ", &t);
+  return buffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void toISO (UnitTest& t, const std::string& epoch, bool valid, const std::string& expected)
+{
+  std::string result;
+  t.is (epochToISO (epoch, result), valid, "epochToISO '" + epoch + "' " + (valid ? "valid" : "rejected"));
+  if (valid)
+    t.is (result, expected, "epochToISO '" + epoch + "' --> " + expected);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void toEpoch (UnitTest& t, const std::string& text, bool valid, time_t expected)
+{
+  time_t result = 0;
+  t.is (isoToEpoch (text, result), valid, "isoToEpoch '" + text + "' " + (valid ? "valid" : "rejected"));
+  if (valid)
+    t.is ((int) result, (int) expected, "isoToEpoch '" + text + "' --> " + std::to_string (expected));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main (int, char**)
+{
+  UnitTest t (sizeof (lengths) / sizeof (lengths[0]) * 5 + 6 + 46);
+
+  // Each vector scan finds the same byte as the plain scan.
+  for (auto length : lengths)
+  {
+    auto strings = variants (length);
+    for (auto width : {16, 32, 0})
+    {
+      bool agree = true;
+      for (auto& s : strings)
+        if (jsonScan (s.data (), s.length (), width) != jsonScan (s.data (), s.length (), 1))
+          agree = false;
+
+      t.ok (agree, "jsonScan width " + std::to_string (width) + " agrees, length " + std::to_string (length));
+    }
+
+    bool encode = true;
+    bool decode = true;
+    for (auto& s : strings)
+    {
+      auto encoded = json::encode (s);
+      if (jsonEncode (s) != encoded)
+        encode = false;
+
+      std::string appended = "x";
+      jsonEncode (appended, s);
+      if (appended != "x" + encoded)
+        encode = false;
+
+      if (jsonDecode (encoded) != json::decode (encoded))
+        decode = false;
+    }
+
+    t.ok (encode, "jsonEncode agrees with json::encode, length " + std::to_string (length));
+    t.ok (decode, "jsonDecode agrees with json::decode, length " + std::to_string (length));
+  }
+
+  // Escapes within one block, and in the tail after the blocks.
+  t.is (jsonEncode ("0123456789\"abc\\ef"),  "0123456789\\\"abc\\\\ef", "jsonEncode two escapes in a block");
+  t.is (jsonEncode ("0123456789abcdefg/"),   "0123456789abcdefg\\/",    "jsonEncode escape in the tail");
+  t.is (jsonEncode ("0123456789abcdef\n"),   "0123456789abcdef\\n",     "jsonEncode escape after a block");
+  t.is (jsonDecode ("0123456789\\\"abc\\\\ef"), "0123456789\"abc\\ef",  "jsonDecode two escapes in a block");
+  t.is (jsonDecode ("0123456789abcdefg\\/"),  "0123456789abcdefg/",     "jsonDecode escape in the tail");
+  t.is (jsonDecode ("\\u00e9"),               "\xc3\xa9",               "jsonDecode \\u00e9");
+
+  // Epochs round trip, and agree with the C library, across the whole range
+  // that epochToISO handles.
+  bool agree = true;
+  bool round = true;
+  for (time_t epoch = 315532800; epoch <= 2147483647 - 3181247; epoch += 3181247)
+  {
+    std::string text;
+    time_t back = 0;
+    if (! epochToISO (std::to_string (epoch), text) || text != iso (epoch))
+      agree = false;
+
+    if (! isoToEpoch (text, back) || back != epoch)
+      round = false;
+  }
+
+  t.ok (agree, "epochToISO agrees with gmtime");
+  t.ok (round, "isoToEpoch (epochToISO (epoch)) == epoch");
+
+  // Range edges: Datetime only reads epochs from 1980 to 2038 as epochs.
+  toISO (t, "315532800",   true,  "19800101T000000Z");
+  toISO (t, "315532799",   false, "");
+  toISO (t, "2147483647",  true,  "20380119T031407Z");
+  toISO (t, "2147483648",  false, "");
+  toISO (t, "1514764800",  true,  "20180101T000000Z");
+
+  // Leap days.
+  toISO (t, "951782400",   true,  "20000229T000000Z");
+  toISO (t, "1709164800",  true,  "20240229T000000Z");
+  toISO (t, "1709251199",  true,  "20240229T235959Z");
+
+  // Not plain epochs.
+  toISO (t, "",            false, "");
+  toISO (t, "12345678",    false, "");
+  toISO (t, "12345678901", false, "");
+  toISO (t, "31553280a",   false, "");
+  toISO (t, "-315532800",  false, "");
+  toISO (t, " 315532800",  false, "");
+
+  toEpoch (t, "19700101T000000Z", true,  0);
+  toEpoch (t, "20180101T000000Z", true,  1514764800);
+  toEpoch (t, "20380119T031407Z", true,  2147483647);
+
+  // Leap days, in leap years only, including 2000 but not 2100.
+  toEpoch (t, "20000229T000000Z", true,  951782400);
+  toEpoch (t, "20240229T235959Z", true,  1709251199);
+  toEpoch (t, "20230229T000000Z", false, 0);
+  toEpoch (t, "21000229T000000Z", false, 0);
+
+  // Out of range fields, and other forms.
+  toEpoch (t, "19691231T235959Z", false, 0);
+  toEpoch (t, "20181301T000000Z", false, 0);
+  toEpoch (t, "20180001T000000Z", false, 0);
+  toEpoch (t, "20180431T000000Z", false, 0);
+  toEpoch (t, "20180100T000000Z", false, 0);
+  toEpoch (t, "20180101T240000Z", false, 0);
+  toEpoch (t, "20180101T006000Z", false, 0);
+  toEpoch (t, "20180101T000060Z", false, 0);
+  toEpoch (t, "20180101T000000",  false, 0);
+  toEpoch (t, "20180101 000000Z", false, 0);
+  toEpoch (t, "2018-01-01T00:00:00Z", false, 0);
+  toEpoch (t, "2018010aT000000Z", false, 0);
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////